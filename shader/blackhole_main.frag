@@ -6,6 +6,81 @@ const float INFINITY = 1000000.0; // 近似表示的无穷大值
 
 out vec4 fragColor; // 输出的片段颜色
 
+// 编译期开关，由createShaderProgram()按ImGui选项以#define注入，
+// 每种组合编译为单独的程序，未定义时取下面的默认值
+#ifndef GRAVITATIONAL_LENSING
+#define GRAVITATIONAL_LENSING 1 // 引力透镜效果开关
+#endif
+#ifndef RENDER_BLACK_HOLE
+#define RENDER_BLACK_HOLE 1     // 黑洞渲染开关
+#endif
+#ifndef ADISK_ENABLED
+#define ADISK_ENABLED 1         // 吸积盘启用开关
+#endif
+#ifndef ADISK_PARTICLE
+#define ADISK_PARTICLE 1        // 吸积盘颗粒启用开关
+#endif
+#ifndef ADISK_NOISE_LOD
+#define ADISK_NOISE_LOD 5       // 吸积盘噪声层级，常量循环次数便于编译器展开
+#endif
+#ifndef CHECKERBOARD
+#define CHECKERBOARD 0          // 棋盘格渲染：每帧只追踪一半像素，输出为半宽图像
+#endif
+#ifndef LENSING_MAP
+#define LENSING_MAP 0           // 透镜映射缓存：0 关闭，1 生成映射，2 按映射着色
+#endif
+#ifndef TEMPORAL_ACCUMULATION
+#define TEMPORAL_ACCUMULATION 0 // 时间累积：每帧只刷新部分像素块，其余从上一帧重投影
+#endif
+#ifndef SUPERSAMPLE
+#define SUPERSAMPLE 0           // 自适应超采样：只对预通道标记的像素追踪子像素光线
+#endif
+#ifndef BRIGHTNESS_OUTPUT
+#define BRIGHTNESS_OUTPUT 0     // 以第二个颜色附件同时输出Bloom亮部，代替单独的亮度提取通道
+#endif
+#ifndef COARSE_TO_FINE
+#define COARSE_TO_FINE 0        // 由粗到细追踪：0 关闭，1 以1/4分辨率追踪粗图，2 按粗图细化
+#endif
+#ifndef ADAPTIVE_STEP
+#define ADAPTIVE_STEP 1         // 自适应步长积分
+#endif
+#ifndef EARLY_ESCAPE
+#define EARLY_ESCAPE 1          // 远离黑洞的光线提前结束积分
+#endif
+#ifndef ESCAPE_CORRECTION
+#define ESCAPE_CORRECTION 1     // 逃逸时补上剩余偏折角
+#endif
+#ifndef LENSING_LUT
+#define LENSING_LUT 1           // 背景光线查表代替逐步积分
+#endif
+#ifndef PLANAR_ORBIT
+#define PLANAR_ORBIT 1          // 在轨道平面内对 u = 1 / r 积分
+#endif
+#ifndef IMPACT_CLASSIFY
+#define IMPACT_CLASSIFY 1       // 按碰撞参数提前识别必然落入视界的光线
+#endif
+#ifndef ADISK_BOUNDS_DEBUG
+#define ADISK_BOUNDS_DEBUG 0    // 调试：输出被包围体跳过(R)和实际执行(G)的吸积盘采样次数
+#endif
+#ifndef COARSE_DEBUG
+#define COARSE_DEBUG 0          // 调试：由粗到细追踪中重新追踪的像素标为红色
+#endif
+#ifndef DISK_CROSSING_CACHE
+#define DISK_CROSSING_CACHE 1   // 透镜映射按缓存的穿越为吸积盘着色，关闭时经过盘的像素都重新追踪
+#endif
+
+#if LENSING_MAP == 1
+// 生成透镜映射时第二、三个颜色附件为两次吸积盘穿越，不输出亮部
+#undef BRIGHTNESS_OUTPUT
+#define BRIGHTNESS_OUTPUT 0
+layout(location = 1) out vec4 diskCrossingOutput1;
+layout(location = 2) out vec4 diskCrossingOutput2;
+#endif
+
+#if BRIGHTNESS_OUTPUT
+layout(location = 1) out vec4 brightColor; // 亮度超过1的部分，与bloom_brightness_pass.frag一致
+#endif
+
 // Uniform变量声明
 uniform vec2 resolution; // 视口分辨率（像素）
 uniform float mouseX;    // 鼠标X位置
@@ -21,30 +96,89 @@ uniform float topView = 0.0;         // 顶视图开关
 uniform float cameraRoll = 0.0;      // 摄像机滚动角度
 
 // 渲染控制参数
-uniform float gravatationalLensing = 1.0; // 引力透镜效果开关
-uniform float renderBlackHole = 1.0;      // 黑洞渲染开关
 uniform float mouseControl = 0.0;          // 鼠标控制开关
 uniform float fovScale = 1.0;              // 视野缩放比例
 
 // 吸积盘（accretion disk）相关参数
-uniform float adiskEnabled = 1.0;      // 吸积盘启用开关
-uniform float adiskParticle = 1.0;     // 吸积盘颗粒启用开关
 uniform float adiskHeight = 0.2;       // 吸积盘高度
 uniform float adiskLit = 0.5;          // 吸积盘亮度
 uniform float adiskDensityV = 1.0;     // 吸积盘垂直密度
 uniform float adiskDensityH = 1.0;     // 吸积盘水平密度
 uniform float adiskNoiseScale = 1.0;   // 吸积盘噪声缩放
-uniform float adiskNoiseLOD = 5.0;     // 吸积盘噪声层级
 uniform float adiskSpeed = 0.5;        // 吸积盘旋转速度
 
-// 圆环结构体定义
-struct Ring {
-  vec3 center;        // 圆环中心位置
-  vec3 normal;        // 圆环法线方向
-  float innerRadius;  // 圆环内半径
-  float outerRadius;  // 圆环外半径
-  float rotateSpeed;  // 圆环旋转速度
-};
+// 自适应步长积分参数
+uniform float stepTolerance = 0.003;   // 每步允许的局部位置误差
+uniform float maxSteps = 300.0;        // 自适应积分的最大步数
+
+// 提前逃逸参数
+uniform float escapeRadius = 12.0;     // 逃逸半径，开启吸积盘时不小于盘的外半径
+
+// 偏折角查找表，由src/cpu/deflection_lut.cpp预计算
+uniform sampler2D deflectionLUT;       // R为总偏折角，G为近心点半径，BA为盘半径以内的方位角区间
+
+#if CHECKERBOARD
+uniform float checkerboardParity = 0.0; // 本帧追踪 (x + y + parity) 为偶数的像素
+uniform float fullWidth;               // 完整图像的宽度，resolution.x 为半宽
+#endif
+
+#if COARSE_TO_FINE == 1
+uniform float fineWidth;               // 细化图像的尺寸，resolution 为粗图尺寸
+uniform float fineHeight;
+#elif COARSE_TO_FINE == 2
+uniform sampler2D coarseImage;         // 1/4分辨率的粗图，每个像素对应4x4像素块的中心
+uniform float coarseThreshold = 0.05;  // 邻域亮度差超过该值的像素重新追踪
+#endif
+
+#if SUPERSAMPLE
+uniform sampler2D supersampleMask;      // 对比度预通道的输出，r为邻域亮度差
+uniform float supersampleThreshold = 0.1; // 超过该值的像素追踪子像素光线，由光线预算调整
+#endif
+
+// 旋转网格的子像素偏移，水平和竖直边缘上都有四个不同的采样位置
+const int SUPERSAMPLE_RAYS = 4;
+const vec2 SUPERSAMPLE_OFFSETS[SUPERSAMPLE_RAYS] =
+    vec2[SUPERSAMPLE_RAYS](vec2(0.125, 0.375), vec2(0.375, -0.125),
+                           vec2(-0.125, -0.375), vec2(-0.375, 0.125));
+
+const int COARSE_FACTOR = 4;           // 粗图每个像素覆盖的像素数（每个方向）
+
+const int MAX_DISK_CROSSINGS = 2;      // 缓存的吸积盘穿越次数上限
+
+#if LENSING_MAP == 2
+// 每个像素的逃逸方向（八面体编码，rg）、透过吸积盘的剩余权重（b）
+// 和吸积盘状态（a）：0 未经过，0.5 穿越次数不超过上限，1 需要重新追踪。
+// 由 LENSING_MAP == 1 的通道生成
+uniform sampler2D lensingMap;
+// 每次穿越进入吸积盘包围体时积分器的状态，见recordDiskCrossing()，没有穿越时为0
+uniform sampler2D diskCrossings1;
+uniform sampler2D diskCrossings2;
+#endif
+
+#if TEMPORAL_ACCUMULATION
+uniform sampler2D history;             // 上一帧输出，a为吸积盘遮罩
+uniform float historyValid = 0.0;      // 参数、分辨率改变后历史失效
+uniform float frameIndex = 0.0;        // 决定本帧刷新哪些像素块
+uniform float temporalLevels = 1.0;    // 每帧刷新 1/4^temporalLevels 的像素块
+uniform float temporalMaxVelocity = 1.0; // 允许复用的最大屏幕位移（像素）
+uniform float prevMouseX;              // 上一帧的鼠标位置，用于重建上一帧的摄像机
+uniform float prevMouseY;
+#endif
+
+const float STEP_SIZE = 0.1;           // 固定步长
+const float MAX_PATH_LENGTH = 30.0;    // 300 * STEP_SIZE，与固定步长积分走过的路径相同
+const float ADISK_OUTER_RADIUS = 12.0; // 吸积盘外半径，与adiskColor()一致
+const float LUT_MIN_RADIUS = 4.0;      // 查找表覆盖的摄像机半径，与DeflectionLUTInfo一致
+const float LUT_MAX_RADIUS = 40.0;
+const float LUT_MIN_PERIAPSIS = 2.5;   // 近心点更靠近光子球的光线偏折角变化剧烈，不查表
+const float PLANAR_MAX_DPHI = 0.1;     // 轨道平面积分的最大方位角步长
+const float ADISK_INNER_RADIUS = 2.6;  // 吸积盘内半径，与adiskColor()一致
+const float PHOTON_SPHERE_RADIUS = 1.5; // 光子球半径 1.5 * rs
+const float CRITICAL_IMPACT_PARAMETER = 2.5980762; // 3 * sqrt(3) * M，rs = 2M = 1
+
+// 吸积盘采样计数，用于ADISK_BOUNDS_DEBUG、时间累积和透镜映射
+int adiskEvaluated = 0;
+int adiskSkipped = 0;
 
 ///----
 /// Simplex 3D Noise 实现
@@ -127,29 +261,6 @@ float snoise(vec3 v) {
 }
 ///----
 
-// 计算光线与圆环的距离，如果有交点则返回距离，否则返回-1.0
-float ringDistance(vec3 rayOrigin, vec3 rayDir, Ring ring) {
-  float denominator = dot(rayDir, ring.normal); // 分母：光线方向与圆环法线的点积
-  float constant = -dot(ring.center, ring.normal); // 常数项
-  if (abs(denominator) < EPSILON) { // 如果分母接近零，表示光线平行于圆环
-    return -1.0;
-  } else {
-    float t = -(dot(rayOrigin, ring.normal) + constant) / denominator; // 求解t值
-    if (t < 0.0) { // 如果t小于0，交点在光线起点之前
-      return -1.0;
-    }
-
-    vec3 intersection = rayOrigin + t * rayDir; // 计算交点位置
-
-    // 计算交点到圆环中心的距离
-    float d = length(intersection - ring.center);
-    if (d >= ring.innerRadius && d <= ring.outerRadius) { // 判断是否在圆环范围内
-      return t;
-    }
-    return -1.0; // 不在圆环范围内
-  }
-}
-
 // 从方向向量获取全景颜色
 vec3 panoramaColor(sampler2D tex, vec3 dir) {
   // 将方向向量转换为UV坐标
@@ -228,58 +339,135 @@ vec3 toSpherical2(vec3 pos) {
   return radialCoords;                                     // 返回调整后的球面坐标
 }
 
-// 计算并设置圆环的颜色
-void ringColor(vec3 rayOrigin, vec3 rayDir, Ring ring, inout float minDistance,
-               inout vec3 color) {
-  float distance = ringDistance(rayOrigin, normalize(rayDir), ring); // 计算光线与圆环的距离
-  if (distance >= EPSILON && distance < minDistance &&
-      distance <= length(rayDir) + EPSILON) { // 判断是否满足条件
-    minDistance = distance; // 更新最小距离
+// 构建视图矩阵
+mat3 lookAt(vec3 origin, vec3 target, float roll) {
+  vec3 rr = vec3(sin(roll), cos(roll), 0.0); // 计算滚动向量
+  vec3 ww = normalize(target - origin);      // 计算视线向量
+  vec3 uu = normalize(cross(ww, rr));       // 计算右向量
+  vec3 vv = normalize(cross(uu, ww));       // 计算上向量
 
-    vec3 intersection = rayOrigin + normalize(rayDir) * minDistance; // 计算交点
-    vec3 ringColor;
+  return mat3(uu, vv, ww); // 返回视图矩阵
+}
 
-    {
-      float dist = length(intersection); // 计算交点距离
+// 计算向量的平方长度
+float sqrLength(vec3 a) { return dot(a, a); }
 
-      float v = clamp((dist - ring.innerRadius) /
-                          (ring.outerRadius - ring.innerRadius),
-                      0.0, 1.0); // 计算归一化距离
+// 按逃逸方向采样随时间旋转的天空盒
+vec3 skyColor(vec3 dir, float alpha) {
+  return texture(galaxy, rotateVector(dir, vec3(0.0, 1.0, 0.0), time)).rgb * alpha;
+}
 
-      vec3 base = cross(ring.normal, vec3(0.0, 0.0, 1.0)); // 计算基准向量
-      float angle = acos(dot(normalize(base), normalize(intersection))); // 计算角度
-      if (dot(cross(base, intersection), ring.normal) < 0.0)
-        angle = -angle; // 根据方向调整角度
+// 落入视界的光线没有逃逸方向
+const vec4 NO_ESCAPE = vec4(0.0, 0.0, 1.0, 0.0);
 
-      float u = 0.5 - 0.5 * angle / PI; // 计算U坐标
-      // HACK：动态旋转
-      u += time * ring.rotateSpeed;
+// 逃逸光线的天空盒颜色。escape为最终方向（天空盒旋转前）及其透过吸积盘的
+// 剩余权重，供透镜映射缓存
+vec3 escapeColor(vec3 dir, float alpha, out vec4 escape) {
+  escape = vec4(dir, alpha);
+  return skyColor(dir, alpha);
+}
 
-      vec3 color = vec3(0.0, 0.5, 0.0); // 圆环基础颜色
-      // HACK：设置透明度
-      float alpha = 0.5;
-      ringColor = vec3(color); // 设置圆环颜色
-    }
+// 单位向量的八面体编码，结果在[-1, 1]，16位定点下方向误差不超过约6e-5弧度
+vec2 octEncode(vec3 n) {
+  n /= abs(n.x) + abs(n.y) + abs(n.z);
+  vec2 p = n.xy;
+  if (n.z < 0.0) {
+    p = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  }
+  return p;
+}
 
-    color += ringColor; // 叠加颜色
+vec3 octDecode(vec2 p) {
+  vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+  if (n.z < 0.0) {
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
   }
+  return normalize(n);
 }
 
-// 构建视图矩阵
-mat3 lookAt(vec3 origin, vec3 target, float roll) {
-  vec3 rr = vec3(sin(roll), cos(roll), 0.0); // 计算滚动向量
-  vec3 ww = normalize(target - origin);      // 计算视线向量
-  vec3 uu = normalize(cross(ww, rr));       // 计算右向量
-  vec3 vv = normalize(cross(uu, ww));       // 计算上向量
+// 吸积盘的保守包围体：|y| < adiskHeight 的平板与外半径圆柱的交集，
+// 包围体外adiskColor()的密度必为0，连同噪声在内整个跳过
+bool inDiskBounds(vec3 pos) {
+  bool inside = abs(pos.y) < adiskHeight &&
+                dot(pos.xz, pos.xz) < ADISK_OUTER_RADIUS * ADISK_OUTER_RADIUS;
+  if (inside) {
+    adiskEvaluated++;
+  } else {
+    adiskSkipped++;
+  }
+  return inside;
+}
 
-  return mat3(uu, vv, ww); // 返回视图矩阵
+#if LENSING_MAP == 1
+// 按穿越记录积分器进入吸积盘包围体时的状态：两次包围体内的步之间有包围体外的步
+// （adiskSkipped增加）即为新的穿越。着色时由shadeDiskCrossing()从该状态继续积分，
+// 在与直接追踪相同的采样点上重新计算随时间流动的噪声
+vec4 diskCrossings[MAX_DISK_CROSSINGS];
+int diskCrossingCount = 0;
+int diskCrossingSkipped = -1;
+
+void recordDiskCrossing(vec4 state) {
+  if (adiskSkipped != diskCrossingSkipped) {
+    diskCrossingSkipped = adiskSkipped;
+    diskCrossingCount++;
+    if (diskCrossingCount <= MAX_DISK_CROSSINGS) {
+      diskCrossings[diskCrossingCount - 1] = state;
+    }
+  }
 }
 
-// 计算向量的平方长度
-float sqrLength(vec3 a) { return dot(a, a); }
+// 积分因步数或路径长度用尽而结束时，从穿越处继续积分不会停在同一处，
+// 经过吸积盘的像素整个重新追踪
+void recordStepLimit() {
+  if (diskCrossingCount > 0) {
+    diskCrossingCount = MAX_DISK_CROSSINGS + 1;
+  }
+}
+#else
+void recordDiskCrossing(vec4 state) {}
+void recordStepLimit() {}
+#endif
+
+// 逐步积分的状态：位置和径向速度。中心力下 cross(pos, dir) 守恒，
+// 恢复时由角动量h得到切向速度。包围体内 r >= 1，状态不会为0
+vec4 packDiskState(vec3 pos, vec3 dir) { return vec4(pos, dot(pos, dir) / length(pos)); }
+
+vec3 unpackDiskDirection(vec4 state, vec3 h) {
+  float r2 = dot(state.xyz, state.xyz);
+  return state.xyz * (state.w * inversesqrt(r2)) + cross(h, state.xyz) / r2;
+}
 
-// 计算并设置吸积盘的颜色
-void adiskColor(vec3 pos, inout vec3 color, inout float alpha) {
+// 吸积盘颗粒的多级噪声，随时间流动
+float adiskNoise(vec3 sphericalCoord) {
+  float noise = 1.0;
+  for (int i = 0; i < ADISK_NOISE_LOD; i++) { // 多级噪声叠加
+    noise *= 0.5 * snoise(sphericalCoord * pow(i, 2) * adiskNoiseScale) + 0.5;
+    if (i % 2 == 0) {
+      sphericalCoord.y += time * adiskSpeed; // 动态调整y坐标
+    } else {
+      sphericalCoord.y -= time * adiskSpeed;
+    }
+  }
+  return noise;
+}
+
+// 由静态权重（密度、透明度和采样加权之积）和球坐标得到吸积盘颜色
+vec3 adiskShade(vec3 sphericalCoord, float weight) {
+#if !ADISK_PARTICLE // 如果颗粒模式关闭
+  return vec3(0.0, 1.0, 0.0) * weight * 0.02; // 添加绿色颗粒
+#else
+  vec3 dustColor = texture(colorMap, vec2(sphericalCoord.x / ADISK_OUTER_RADIUS, 0.5))
+                       .rgb; // 采样颜色贴图
+  return weight * adiskLit * dustColor * abs(adiskNoise(sphericalCoord));
+#endif
+}
+
+// 计算并设置吸积盘的颜色，sampleWeight为调用者对本次采样的加权，
+// 自适应步长时为 dt / STEP_SIZE
+void adiskColor(vec3 pos, float sampleWeight, inout vec3 color, inout float alpha) {
+#if LENSING_MAP == 1
+  return; // 生成映射时只记录穿越，颜色在着色时计算
+#endif
   float innerRadius = 2.6; // 吸积盘内半径
   float outerRadius = 12.0; // 吸积盘外半径
 
@@ -309,33 +497,116 @@ void adiskColor(vec3 pos, inout vec3 color, inout float alpha) {
   density *= 1.0 / pow(sphericalCoord.x, adiskDensityH); // 根据rho调整密度
   density *= 16000.0; // 缩放密度值
 
-  if (adiskParticle < 0.5) { // 如果颗粒模式关闭
-    color += vec3(0.0, 1.0, 0.0) * density * 0.02; // 添加绿色颗粒
-    return;
+  color += adiskShade(sphericalCoord, density * alpha * sampleWeight); // 叠加吸积盘颜色
+}
+
+// 判断光线是否已经逃逸：位于逃逸半径外且径向速度向外。
+// 径向速度为正后r单调增加，之后既不会落入视界也不会再穿过吸积盘
+bool isEscaping(vec3 pos, vec3 dir) {
+#if !EARLY_ESCAPE
+  return false;
+#endif
+#if ADISK_ENABLED
+  float radius = max(escapeRadius, ADISK_OUTER_RADIUS);
+#else
+  float radius = escapeRadius;
+#endif
+  return dot(pos, pos) > radius * radius && dot(pos, dir) > 0.0;
+}
+
+// 用弱场近似计算从当前位置到无穷远处剩余的偏折，返回修正后的单位方向。
+// 沿直线对加速度的横向分量积分，mu为径向速度分量（cos），b为碰撞参数：
+//   delta = (1 - mu)^2 * (2 + mu) / (2 * b)
+// mu = -1时为完整的 2 / b（rs = 1），mu = 1时为0
+vec3 asymptoticDirection(vec3 pos, vec3 dir) {
+  dir = normalize(dir);
+#if !GRAVITATIONAL_LENSING
+  return dir;
+#endif
+  vec3 perp = pos - dot(pos, dir) * dir; // 位置垂直于光线的分量，长度为b
+  float b = length(perp);
+  if (b < EPSILON) {
+    return dir;
   }
+  float mu = dot(pos, dir) / length(pos);
+  float delta = (1.0 - mu) * (1.0 - mu) * (2.0 + mu) / (2.0 * b);
+  return dir * cos(delta) - perp * (sin(delta) / b); // 在轨道平面内偏向中心
+}
 
-  float noise = 1.0;
-  for (int i = 0; i < int(adiskNoiseLOD); i++) { // 多级噪声叠加
-    noise *= 0.5 * snoise(sphericalCoord * pow(i, 2) * adiskNoiseScale) + 0.5;
-    if (i % 2 == 0) {
-      sphericalCoord.y += time * adiskSpeed; // 动态调整y坐标
-    } else {
-      sphericalCoord.y -= time * adiskSpeed;
+const float LUT_PHI_MARGIN = 0.05; // 查表得到的方位角区间在插值时的误差上界
+
+// 光线在轨道平面内方位角 [phiEnter, phiExit] 之间位于吸积盘外半径以内，e1指向
+// 摄像机，e2为切向。方位角phi处径向单位向量的y分量为 e1.y * cos(phi) + e2.y * sin(phi)，
+// 区间内没有零点时光线在盘半径以内不穿过赤道面，且 |y| 不小于近心点乘以该分量
+// 在两端的较小值。返回false时光线一定不会进入吸积盘所在的平板
+bool crossesDiskSlab(vec3 e1, vec3 e2, float phiEnter, float phiExit, float periapsis) {
+  phiEnter = max(phiEnter - LUT_PHI_MARGIN, 0.0);
+  phiExit += LUT_PHI_MARGIN;
+  // 区间起点之后的第一个零点
+  float zero = phiEnter + mod(atan(e2.y, e1.y) + 0.5 * PI - phiEnter, PI);
+  if (zero <= phiExit) {
+    return true;
+  }
+  float yEnter = e1.y * cos(phiEnter) + e2.y * sin(phiEnter);
+  float yExit = e1.y * cos(phiExit) + e2.y * sin(phiExit);
+  return periapsis * min(abs(yEnter), abs(yExit)) <= adiskHeight;
+}
+
+// 查表得到背景光线的最终方向，dir为单位方向。近心点靠近光子球的光线
+// 插值误差大，开启吸积盘时在盘半径以内可能进入盘所在平板的光线还需要逐步采样，
+// 这两类返回false
+bool traceColorLUT(vec3 pos, vec3 dir, out vec3 color, out vec4 escape) {
+  color = vec3(0.0);
+  escape = NO_ESCAPE;
+#if !RENDER_BLACK_HOLE || !GRAVITATIONAL_LENSING || !LENSING_LUT
+  return false;
+#endif
+
+  float r0 = length(pos);
+  if (r0 < LUT_MIN_RADIUS || r0 > LUT_MAX_RADIUS) {
+    return false;
+  }
+
+  // 横轴为光线与指向中心方向的夹角，纹素i位于 alpha = PI * i / (width - 1)。
+  // 纹素为 (偏折角, 近心点, 进入和离开盘半径的方位角)
+  float alpha = acos(clamp(-dot(pos, dir) / r0, -1.0, 1.0));
+  vec2 size = vec2(textureSize(deflectionLUT, 0));
+  vec2 t = vec2(alpha / PI,
+                (r0 - LUT_MIN_RADIUS) / (LUT_MAX_RADIUS - LUT_MIN_RADIUS));
+  vec4 deflection = texture(deflectionLUT, (t * (size - 1.0) + 0.5) / size);
+
+  if (deflection.y < LUT_MIN_PERIAPSIS) {
+    return false;
+  }
+#if ADISK_ENABLED
+  if (deflection.y < ADISK_OUTER_RADIUS) {
+    vec3 e1 = pos / r0;
+    vec3 tangent = dir - dot(dir, e1) * e1;
+    float sinAlpha = length(tangent);
+    if (sinAlpha < EPSILON ||
+        crossesDiskSlab(e1, tangent / sinAlpha, deflection.z, deflection.w, deflection.y)) {
+      return false;
     }
   }
+#endif
 
-  vec3 dustColor =
-      texture(colorMap, vec2(sphericalCoord.x / outerRadius, 0.5)).rgb; // 采样颜色贴图
+  // 在轨道平面内朝中心方向旋转偏折角
+  vec3 perp = pos - dot(pos, dir) * dir;
+  float b = length(perp);
+  if (b > EPSILON) {
+    dir = dir * cos(deflection.x) - perp * (sin(deflection.x) / b);
+  }
 
-  color += density * adiskLit * dustColor * alpha * abs(noise); // 叠加吸积盘颜色
+  color = escapeColor(dir, 1.0, escape);
+  return true;
 }
 
 // 光线追踪计算颜色
-vec3 traceColor(vec3 pos, vec3 dir) {
+vec3 traceColor(vec3 pos, vec3 dir, out vec4 escape) {
+  escape = NO_ESCAPE;
   vec3 color = vec3(0.0); // 初始颜色为黑色
   float alpha = 1.0;       // 初始透明度
 
-  float STEP_SIZE = 0.1; // 光线步长
   dir *= STEP_SIZE;      // 缩放方向向量
 
   // 初始值
@@ -343,71 +614,642 @@ vec3 traceColor(vec3 pos, vec3 dir) {
   float h2 = dot(h, h);     // 角动量平方
 
   for (int i = 0; i < 300; i++) { // 最大迭代次数
-    if (renderBlackHole > 0.5) { // 如果黑洞渲染开启
-      // 如果引力透镜效果开启
-      if (gravatationalLensing > 0.5) {
-        vec3 acc = accel(h2, pos); // 计算加速度
-        dir += acc; // 更新方向
-      }
+#if RENDER_BLACK_HOLE // 如果黑洞渲染开启
+#if GRAVITATIONAL_LENSING // 如果引力透镜效果开启
+    vec3 acc = accel(h2, pos); // 计算加速度
+    dir += acc; // 更新方向
+#endif
+
+    // 如果到达事件视界，返回当前颜色
+    if (dot(pos, pos) < 1.0) {
+      return color;
+    }
 
-      // 如果到达事件视界，返回当前颜色
-      if (dot(pos, pos) < 1.0) {
-        return color;
-      }
+    // 已逃逸的光线直接采样天空盒
+    if (isEscaping(pos, dir)) {
+#if ESCAPE_CORRECTION
+      dir = asymptoticDirection(pos, dir);
+#endif
+      return color + escapeColor(dir, alpha, escape);
+    }
 
-      float minDistance = INFINITY; // 初始化最小距离
-
-      if (false) { // 预留代码块，可用于添加圆环渲染
-        Ring ring;
-        ring.center = vec3(0.0, 0.05, 0.0);
-        ring.normal = vec3(0.0, 1.0, 0.0);
-        ring.innerRadius = 2.0;
-        ring.outerRadius = 6.0;
-        ring.rotateSpeed = 0.08;
-        ringColor(pos, dir, ring, minDistance, color);
-      } else {
-        if (adiskEnabled > 0.5) { // 如果吸积盘渲染开启
-          adiskColor(pos, color, alpha); // 计算吸积盘颜色
-        }
-      }
+#if ADISK_ENABLED // 如果吸积盘渲染开启
+    if (inDiskBounds(pos)) {
+      recordDiskCrossing(packDiskState(pos, dir));
+      adiskColor(pos, 1.0, color, alpha); // 计算吸积盘颜色
     }
+#endif
+#endif
 
     pos += dir; // 更新位置
   }
+#if RENDER_BLACK_HOLE
+  recordStepLimit();
+#endif
 
   // 采样天空盒颜色
-  dir = rotateVector(dir, vec3(0.0, 1.0, 0.0), time); // 旋转方向向量
-  color += texture(galaxy, dir).rgb * alpha; // 叠加天空盒颜色
+  color += escapeColor(dir, alpha, escape); // 叠加天空盒颜色
   return color; // 返回最终颜色
 }
 
-void main() {
-  mat3 view; // 视图矩阵
+// 根据半径、局部曲率和到吸积盘的距离选择步长
+float adaptiveStepSize(vec3 pos, float r2, float h2) {
+  float r = sqrt(r2);
+  float dt = STEP_SIZE * r; // 步长随半径线性放大
+
+  // 以 0.5 * |a| * dt^2 估计每步的位置误差
+#if GRAVITATIONAL_LENSING
+  float accMag = 1.5 * h2 / (r2 * r2);
+  dt = min(dt, sqrt(2.0 * stepTolerance / max(accMag, EPSILON * EPSILON)));
+#endif
+
+  // 吸积盘外不会跨过盘的包围圆柱，盘内保持固定步长以保证体积采样一致
+#if ADISK_ENABLED
+  float diskDist = max(abs(pos.y) - adiskHeight,
+                       length(pos.xz) - ADISK_OUTER_RADIUS);
+  dt = min(dt, max(diskDist, STEP_SIZE));
+#endif
+
+  return max(dt, STEP_SIZE * 0.1);
+}
+
+// 自适应步长的光线追踪，dir为单位方向，用蛙跳法（速度Verlet）积分
+vec3 traceColorAdaptive(vec3 pos, vec3 dir, out vec4 escape) {
+  escape = NO_ESCAPE;
+  vec3 color = vec3(0.0);
+  float alpha = 1.0;
+
+  vec3 h = cross(pos, dir);
+  float h2 = dot(h, h);
+
+#if RENDER_BLACK_HOLE // 关闭时直线传播，方向不变
+  float pathLength = 0.0;
+  vec3 acc = accel(h2, pos);
+  for (int i = 0; i < int(maxSteps) && pathLength < MAX_PATH_LENGTH; i++) {
+    float r2 = dot(pos, pos);
+    if (r2 < 1.0) { // 到达事件视界
+      return color;
+    }
+    if (isEscaping(pos, dir)) {
+#if ESCAPE_CORRECTION
+      dir = asymptoticDirection(pos, dir);
+#endif
+      return color + escapeColor(dir, alpha, escape);
+    }
+
+    // 不越过与固定步长积分相同的终点
+    float dt = min(adaptiveStepSize(pos, r2, h2), MAX_PATH_LENGTH - pathLength);
+#if ADISK_ENABLED
+    if (inDiskBounds(pos)) {
+      // 盘内的体积采样按步长加权，与固定步长的累加结果一致
+      recordDiskCrossing(packDiskState(pos, dir));
+      adiskColor(pos, dt / STEP_SIZE, color, alpha);
+    }
+#endif
+
+#if GRAVITATIONAL_LENSING
+    dir += acc * (0.5 * dt);
+    pos += dir * dt;
+    acc = accel(h2, pos); // 每步只计算一次加速度
+    dir += acc * (0.5 * dt);
+#else
+    pos += dir * dt;
+#endif
+    pathLength += dt;
+  }
+  recordStepLimit();
+#endif
+
+  color += escapeColor(dir, alpha, escape);
+  return color;
+}
+
+// 光子球外碰撞参数小于临界值且向内运动的光线没有近心点，必然落入视界。
+// dir为单位方向
+bool isCaptured(vec3 pos, vec3 dir) {
+#if !RENDER_BLACK_HOLE || !GRAVITATIONAL_LENSING || !IMPACT_CLASSIFY
+  return false;
+#endif
+  vec3 h = cross(pos, dir);
+  return dot(pos, pos) > PHOTON_SPHERE_RADIUS * PHOTON_SPHERE_RADIUS &&
+         dot(pos, dir) < 0.0 &&
+         dot(h, h) < CRITICAL_IMPACT_PARAMETER * CRITICAL_IMPACT_PARAMETER;
+}
+
+// 必然落入视界的光线只累加吸积盘的颜色。r单调减小，离开吸积盘所在区域
+// （|y| < adiskHeight 且 r < 12）或进入内半径后不再有贡献，关闭吸积盘时为黑色
+vec3 traceColorCaptured(vec3 pos, vec3 dir, out vec4 escape) {
+  escape = NO_ESCAPE;
+  vec3 color = vec3(0.0);
+  float alpha = 1.0;
+#if !ADISK_ENABLED
+  return color;
+#endif
+
+  vec3 h = cross(pos, dir);
+  float h2 = dot(h, h);
+
+  bool crossed = false;
+  vec3 acc = accel(h2, pos);
+  for (int i = 0; i < int(maxSteps); i++) {
+    float r2 = dot(pos, pos);
+    if (r2 < ADISK_INNER_RADIUS * ADISK_INNER_RADIUS) {
+      return color;
+    }
+    bool inside = inDiskBounds(pos);
+    if (crossed && !inside) {
+      return color;
+    }
+    crossed = crossed || inside;
+
+    float dt = adaptiveStepSize(pos, r2, h2);
+    if (inside) {
+      recordDiskCrossing(packDiskState(pos, dir));
+      adiskColor(pos, dt / STEP_SIZE, color, alpha);
+    }
+
+    dir += acc * (0.5 * dt);
+    pos += dir * dt;
+    acc = accel(h2, pos);
+    dir += acc * (0.5 * dt);
+  }
+  recordStepLimit();
+  return color;
+}
+
+// 比奈方程 u'' = -u + k * u^2 （u = 1 / r，对方位角求导）的四阶龙格-库塔单步，
+// state为(u, du/dphi)，开启引力透镜时k = 1.5，否则为直线
+vec2 binetStep(vec2 state, float k, float dphi) {
+  vec2 k1 = vec2(state.y, -state.x + k * state.x * state.x);
+  vec2 s2 = state + 0.5 * dphi * k1;
+  vec2 k2 = vec2(s2.y, -s2.x + k * s2.x * s2.x);
+  vec2 s3 = state + 0.5 * dphi * k2;
+  vec2 k3 = vec2(s3.y, -s3.x + k * s3.x * s3.x);
+  vec2 s4 = state + dphi * k3;
+  vec2 k4 = vec2(s4.y, -s4.x + k * s4.x * s4.x);
+  return state + dphi / 6.0 * (k1 + 2.0 * k2 + 2.0 * k3 + k4);
+}
+
+// 由一步两端的状态对u做三次Hermite插值，t取[0, 1]
+float hermite(vec2 s0, vec2 s1, float dphi, float t) {
+  float t2 = t * t;
+  float t3 = t2 * t;
+  return (2.0 * t3 - 3.0 * t2 + 1.0) * s0.x + (t3 - 2.0 * t2 + t) * dphi * s0.y +
+         (-2.0 * t3 + 3.0 * t2) * s1.x + (t3 - t2) * dphi * s1.y;
+}
+
+// 轨道平面内方位角phi、u = x处到吸积盘所在区域（|y| < adiskHeight 且 r < 12）
+// 的距离下界，在区域内时不大于0
+float planarDiskDistance(vec3 e1, vec3 e2, float phi, float x) {
+  float y = (e1.y * cos(phi) + e2.y * sin(phi)) / x;
+  return max(abs(y) - adiskHeight, 1.0 / x - ADISK_OUTER_RADIUS);
+}
+
+// 在光线的轨道平面内积分。e1指向初始位置，e2为与之垂直的切向，
+// 方位角phi处的点为 (cos(phi) * e1 + sin(phi) * e2) / u，每步只做标量运算。
+// 吸积盘所在区域的入口由求根得到，区域内按固定弧长STEP_SIZE采样
+vec3 traceColorPlanar(vec3 pos, vec3 dir, out vec4 escape) {
+  float r0 = length(pos);
+  vec3 e1 = pos / r0;
+  vec3 tangent = dir - dot(dir, e1) * e1;
+  float sinAlpha = length(tangent);
+#if !RENDER_BLACK_HOLE
+  return traceColorAdaptive(pos, dir, escape);
+#endif
+  if (sinAlpha < EPSILON) {
+    return traceColorAdaptive(pos, dir, escape); // 径向光线的轨道平面不确定
+  }
+  vec3 e2 = tangent / sinAlpha;
+
+  escape = NO_ESCAPE;
+  vec3 color = vec3(0.0);
+  float alpha = 1.0;
+
+#if GRAVITATIONAL_LENSING
+  float k = 1.5;
+#else
+  float k = 0.0;
+#endif
+  vec2 state = vec2(1.0 / r0, -dot(dir, e1) / (sinAlpha * r0)); // (u, du/dphi)
+  float phi = 0.0;
+  bool inside = false;
+  for (int i = 0; i < int(maxSteps); i++) {
+    vec3 radial = e1 * cos(phi) + e2 * sin(phi);
+    vec3 p = radial / state.x;
+    // 径向速度与 -du/dphi 同号，确认逃逸后才构造切向
+    if (isEscaping(p, -radial * state.y)) {
+      vec3 normal = e2 * cos(phi) - e1 * sin(phi);
+      vec3 d = normalize(normal * state.x - radial * state.y);
+#if ESCAPE_CORRECTION
+      d = asymptoticDirection(p, d);
+#endif
+      return color + escapeColor(d, alpha, escape);
+    }
+
+    // 弧长 ds = dphi / u * sqrt(1 + (u' / u)^2)
+    float slope = state.y / state.x;
+    float phiPerLength = state.x / sqrt(1.0 + slope * slope);
+    float dphi = PLANAR_MAX_DPHI;
+#if ADISK_ENABLED
+    if (inside) {
+      recordDiskCrossing(vec4(phi, state, 0.0));
+      adiskColor(p, 1.0, color, alpha);
+      adiskEvaluated++;
+      dphi = STEP_SIZE * phiPerLength;
+    } else {
+      adiskSkipped++;
+      dphi = min(dphi, max(planarDiskDistance(e1, e2, phi, state.x), STEP_SIZE) *
+                           phiPerLength);
+    }
+#endif
 
-  vec3 cameraPos; // 摄像机位置
+    vec2 start = state;
+    state = binetStep(state, k, dphi);
+    if (state.x >= 1.0) { // 到达事件视界
+      return color;
+    }
+    if (state.x <= 0.0) {
+      // 在u = 0处插值出逃逸方位角，该处的径向即为最终方向
+      phi += dphi * start.x / (start.x - state.x);
+      dir = e1 * cos(phi) + e2 * sin(phi);
+      return color + escapeColor(dir, alpha, escape);
+    }
+
+#if ADISK_ENABLED
+    bool entering =
+        !inside && planarDiskDistance(e1, e2, phi + dphi, state.x) <= 0.0;
+    if (entering) {
+      // 二分求出进入区域的方位角，退回到该处
+      float lo = 0.0;
+      float hi = dphi;
+      for (int j = 0; j < 8; j++) {
+        float mid = 0.5 * (lo + hi);
+        float x = hermite(start, state, dphi, mid / dphi);
+        if (planarDiskDistance(e1, e2, phi + mid, x) <= 0.0) {
+          hi = mid;
+        } else {
+          lo = mid;
+        }
+      }
+      dphi = hi;
+      state = binetStep(start, k, dphi);
+    }
+    inside = entering ||
+             (inside && planarDiskDistance(e1, e2, phi + dphi, state.x) <= 0.0);
+#endif
+    phi += dphi;
+  }
+
+  // 步数用尽时按当前切向采样天空盒
+  recordStepLimit();
+  vec3 radial = e1 * cos(phi) + e2 * sin(phi);
+  vec3 normal = e2 * cos(phi) - e1 * sin(phi);
+  dir = normalize(normal * state.x - radial * state.y);
+  return color + escapeColor(dir, alpha, escape);
+}
+
+// 摄像机位置，mousePixel为鼠标的像素坐标，screenSize为完整图像的尺寸
+vec3 cameraPosition(vec2 mousePixel, vec2 screenSize) {
   if (mouseControl > 0.5) { // 如果启用鼠标控制
-    vec2 mouse = clamp(vec2(mouseX, mouseY) / resolution.xy, 0.0, 1.0) - 0.5; // 归一化鼠标坐标
-    cameraPos = vec3(-cos(mouse.x * 10.0) * 15.0, mouse.y * 30.0,
-                     sin(mouse.x * 10.0) * 15.0); // 根据鼠标位置计算摄像机位置
+    vec2 mouse = clamp(mousePixel / screenSize, 0.0, 1.0) - 0.5; // 归一化鼠标坐标
+    return vec3(-cos(mouse.x * 10.0) * 15.0, mouse.y * 30.0,
+                sin(mouse.x * 10.0) * 15.0); // 根据鼠标位置计算摄像机位置
 
   } else if (frontView > 0.5) { // 前视图
-    cameraPos = vec3(10.0, 1.0, 10.0);
+    return vec3(10.0, 1.0, 10.0);
   } else if (topView > 0.5) { // 顶视图
-    cameraPos = vec3(15.0, 15.0, 0.0);
-  } else { // 默认动态视角
-    cameraPos = vec3(-cos(time * 0.1) * 15.0, sin(time * 0.1) * 15.0,
-                     sin(time * 0.1) * 15.0);
+    return vec3(15.0, 15.0, 0.0);
+  }
+  // 默认动态视角
+  return vec3(-cos(time * 0.1) * 15.0, sin(time * 0.1) * 15.0,
+              sin(time * 0.1) * 15.0);
+}
+
+#if TEMPORAL_ACCUMULATION
+// 以8x8像素块为单位选择刷新，整个warp一起跳过或一起追踪，避免分支发散
+const int TEMPORAL_BLOCK = 8;
+
+// 有序抖动矩阵的秩：每帧刷新的块均匀散布在屏幕上，
+// 连续 4^levels 帧内每个块恰好刷新一次
+int bayerRank(ivec2 p, int levels) {
+  int rank = 0;
+  for (int i = 0; i < levels; i++) {
+    int x = (p.x >> i) & 1;
+    int y = (p.y >> i) & 1;
+    rank = rank * 4 + (((x ^ y) << 1) | y);
   }
+  return rank;
+}
 
-  vec3 target = vec3(0.0, 0.0, 0.0); // 摄像机目标位置
-  view = lookAt(cameraPos, target, radians(cameraRoll)); // 构建视图矩阵
+// 把当前光线方向投影到上一帧的摄像机，取上一帧的颜色。
+// 轮到刷新、历史失效、出屏、位移过大或落在流动的吸积盘上时返回false
+bool reuseHistory(vec3 dir, vec2 fragCoord, vec2 screenSize, out vec4 color) {
+  color = vec4(0.0);
+  if (historyValid < 0.5) {
+    return false;
+  }
+  // 默认视角的摄像机每帧都在运动
+  if (mouseControl < 0.5 && frontView < 0.5 && topView < 0.5) {
+    return false;
+  }
 
-  vec2 uv = gl_FragCoord.xy / resolution.xy - vec2(0.5); // 标准化片段坐标
-  uv.x *= resolution.x / resolution.y; // 修正纵横比
+  int levels = int(temporalLevels);
+  int period = 1 << (2 * levels);
+  ivec2 block = ivec2(fragCoord) / TEMPORAL_BLOCK;
+  if (bayerRank(block, levels) == int(frameIndex) % period) {
+    return false;
+  }
+
+  // 只按方向重投影：摄像机平移时近处的透镜像有视差，靠位移阈值拒绝
+  vec3 prevCameraPos = cameraPosition(vec2(prevMouseX, prevMouseY), screenSize);
+  mat3 prevView = lookAt(prevCameraPos, vec3(0.0), radians(cameraRoll));
+  vec3 local = transpose(prevView) * dir;
+  if (local.z <= 0.0) {
+    return false;
+  }
+  vec2 uv = vec2(-local.x, local.y) / (local.z * fovScale);
+  uv.x *= screenSize.y / screenSize.x;
+  vec2 prevPixel = (uv + 0.5) * screenSize;
+  if (any(lessThan(prevPixel, vec2(0.0))) ||
+      any(greaterThanEqual(prevPixel, screenSize))) {
+    return false;
+  }
+  if (length(prevPixel - fragCoord) > temporalMaxVelocity) {
+    return false;
+  }
+
+  color = texelFetch(history, ivec2(prevPixel), 0);
+  // 吸积盘随时间流动，盘上的像素每帧重新追踪；天空盒转得很慢，按块轮流刷新即可
+  return color.a < 0.5 || adiskSpeed <= 0.0;
+}
+#endif
+
+// 尺寸为screenSize的完整图像中像素坐标pixel处的光线方向
+vec3 rayDirection(mat3 view, vec2 pixel, vec2 screenSize) {
+  vec2 uv = pixel / screenSize - vec2(0.5); // 标准化片段坐标
+  uv.x *= screenSize.x / screenSize.y; // 修正纵横比
 
   vec3 dir = normalize(vec3(-uv.x * fovScale, uv.y * fovScale, 1.0)); // 计算光线方向
+  return view * dir; // 应用视图变换
+}
+
+// 按光线的类型选择追踪方法，escape见escapeColor()
+vec3 traceRay(vec3 pos, vec3 dir, out vec4 escape) {
+  vec3 color;
+  if (isCaptured(pos, dir)) { // 阴影区的光线只需追踪到吸积盘
+    return traceColorCaptured(pos, dir, escape);
+  } else if (traceColorLUT(pos, dir, color, escape)) { // 不经过吸积盘的背景光线直接查表
+    return color;
+  }
+#if PLANAR_ORBIT
+  return traceColorPlanar(pos, dir, escape);
+#elif ADAPTIVE_STEP
+  return traceColorAdaptive(pos, dir, escape);
+#else
+  return traceColor(pos, dir, escape);
+#endif
+}
+
+#if LENSING_MAP == 2
+// 从缓存的穿越状态继续积分到光线离开吸积盘包围体，返回这一段的吸积盘颜色。
+// pos、dir为像素光线的起点和单位方向，按traceRay()的选择恢复同一种积分，
+// 步长和采样点与直接追踪相同
+vec3 shadeDiskCrossing(vec3 pos, vec3 dir, vec4 state) {
+  vec3 color = vec3(0.0);
+  float alpha = 1.0;
+  bool captured = isCaptured(pos, dir);
+
+#if PLANAR_ORBIT
+  // 状态为 (phi, u, du/dphi)，与traceColorPlanar()中包围体内的一步相同
+  float r0 = length(pos);
+  vec3 e1 = pos / r0;
+  vec3 tangent = dir - dot(dir, e1) * e1;
+  float sinAlpha = length(tangent);
+  if (!captured && sinAlpha >= EPSILON) {
+    vec3 e2 = tangent / sinAlpha;
+#if GRAVITATIONAL_LENSING
+    float k = 1.5;
+#else
+    float k = 0.0;
+#endif
+    float phi = state.x;
+    vec2 s = state.yz;
+    for (int i = 0; i < int(maxSteps); i++) {
+      adiskColor((e1 * cos(phi) + e2 * sin(phi)) / s.x, 1.0, color, alpha);
+      float slope = s.y / s.x;
+      float dphi = STEP_SIZE * s.x / sqrt(1.0 + slope * slope);
+      s = binetStep(s, k, dphi);
+      if (s.x >= 1.0 || s.x <= 0.0 || planarDiskDistance(e1, e2, phi + dphi, s.x) > 0.0) {
+        break;
+      }
+      phi += dphi;
+    }
+    return color;
+  }
+#endif
+
+#if !PLANAR_ORBIT && !ADAPTIVE_STEP
+  // 固定步长，与traceColor()相同：方向按步长缩放，先更新方向再判断是否仍在包围体内
+  if (!captured) {
+    vec3 h = cross(pos, dir * STEP_SIZE);
+    float h2 = dot(h, h);
+    vec3 p = state.xyz;
+    vec3 d = unpackDiskDirection(state, h);
+    for (int i = 0; i < 300; i++) {
+      adiskColor(p, 1.0, color, alpha);
+      p += d;
+#if GRAVITATIONAL_LENSING
+      d += accel(h2, p);
+#endif
+      if (dot(p, p) < 1.0 || !inDiskBounds(p)) {
+        break;
+      }
+    }
+    return color;
+  }
+#endif
+
+  // 蛙跳法，与traceColorAdaptive()和traceColorCaptured()中包围体内的一步相同。
+  // 后者在内半径处停止：临界附近的光线积分后可能折返，不能继续累加
+  vec3 h = cross(pos, dir);
+  float h2 = dot(h, h);
+  float minRadius = captured ? ADISK_INNER_RADIUS : 1.0;
+  vec3 p = state.xyz;
+  vec3 d = unpackDiskDirection(state, h);
+  vec3 acc = accel(h2, p);
+  for (int i = 0; i < int(maxSteps); i++) {
+    float r2 = dot(p, p);
+    if (r2 < minRadius * minRadius || !inDiskBounds(p)) {
+      break;
+    }
+    float dt = adaptiveStepSize(p, r2, h2);
+    adiskColor(p, dt / STEP_SIZE, color, alpha);
+#if GRAVITATIONAL_LENSING
+    d += acc * (0.5 * dt);
+    p += d * dt;
+    acc = accel(h2, p);
+    d += acc * (0.5 * dt);
+#else
+    p += d * dt;
+#endif
+  }
+  return color;
+}
+#endif
+
+#if COARSE_TO_FINE == 2
+// 粗图3x3邻域的亮度差不超过阈值时按双线性插值着色，否则返回false逐像素追踪。
+// 光子环、吸积盘边缘和阴影边界附近亮度变化剧烈，远处的天空盒和阴影内部
+// 平缓，后者占了屏幕的大部分。3x3邻域相当于把边缘向外扩张一个粗像素，
+// 比粗像素间距更细的光子环贴着阴影边界，也会落在追踪区域内。
+// fragCoord为片段在完整图像中的像素坐标
+bool interpolateCoarse(vec2 fragCoord, out vec3 color) {
+  ivec2 coarseMax = ivec2((resolution + float(COARSE_FACTOR - 1)) / float(COARSE_FACTOR)) - 1;
+  // 粗像素i的中心位于完整图像的 COARSE_FACTOR * (i + 0.5)
+  vec2 coarsePos = fragCoord / float(COARSE_FACTOR) - 0.5;
+  ivec2 center = clamp(ivec2(floor(coarsePos + 0.5)), ivec2(0), coarseMax);
+
+  float minLuma = INFINITY;
+  float maxLuma = 0.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      ivec2 p = clamp(center + ivec2(x, y), ivec2(0), coarseMax);
+      float luma = dot(texelFetch(coarseImage, p, 0).rgb, vec3(0.2126, 0.7152, 0.0722));
+      // 压缩HDR亮度，吸积盘高亮区的微小起伏不会触发追踪
+      luma = luma / (1.0 + luma);
+      minLuma = min(minLuma, luma);
+      maxLuma = max(maxLuma, luma);
+    }
+  }
+  if (maxLuma - minLuma > coarseThreshold) {
+    return false;
+  }
+
+  // 双线性插值的2x2样本都在上面的3x3邻域内
+  ivec2 base = ivec2(floor(coarsePos));
+  vec2 f = coarsePos - vec2(base);
+  vec3 c00 = texelFetch(coarseImage, clamp(base, ivec2(0), coarseMax), 0).rgb;
+  vec3 c10 = texelFetch(coarseImage, clamp(base + ivec2(1, 0), ivec2(0), coarseMax), 0).rgb;
+  vec3 c01 = texelFetch(coarseImage, clamp(base + ivec2(0, 1), ivec2(0), coarseMax), 0).rgb;
+  vec3 c11 = texelFetch(coarseImage, clamp(base + ivec2(1, 1), ivec2(0), coarseMax), 0).rgb;
+  color = mix(mix(c00, c10, f.x), mix(c01, c11, f.x), f.y);
+  return true;
+}
+#endif
+
+// 计算片段颜色，各种缓存命中时提前返回
+void shade() {
+  // 片段在完整图像中的像素坐标和完整图像的尺寸，棋盘格和粗图模式下与视口不同
+  vec2 fragCoord;
+  vec2 screenSize;
+#if CHECKERBOARD
+  // 半宽视口的第i列对应完整图像同一行的第2i或2i+1列，相邻行交错，
+  // 所有片段都在追踪，不会像逐像素跳过那样让半个warp空转
+  int row = int(gl_FragCoord.y);
+  float column = floor(gl_FragCoord.x) * 2.0 +
+                 float((row + int(checkerboardParity)) & 1);
+  fragCoord = vec2(column + 0.5, gl_FragCoord.y);
+  screenSize = vec2(fullWidth, resolution.y);
+#elif COARSE_TO_FINE == 1
+  // 粗图的每个片段追踪对应4x4像素块中心的光线
+  fragCoord = gl_FragCoord.xy * float(COARSE_FACTOR);
+  screenSize = vec2(fineWidth, fineHeight);
+#else
+  fragCoord = gl_FragCoord.xy;
+  screenSize = resolution;
+#endif
+
+  mat3 view; // 视图矩阵
+
+  vec3 cameraPos = cameraPosition(vec2(mouseX, mouseY), screenSize); // 摄像机位置
+
+  vec3 target = vec3(0.0, 0.0, 0.0); // 摄像机目标位置
+  view = lookAt(cameraPos, target, radians(cameraRoll)); // 构建视图矩阵
+
+  vec3 dir = rayDirection(view, fragCoord, screenSize);
   vec3 pos = cameraPos; // 初始化光线起点
-  dir = view * dir; // 应用视图变换
+  vec4 escape; // 光线的逃逸方向，生成透镜映射时写出
+
+#if SUPERSAMPLE
+  // 只有对比度预通道标记的像素重新追踪子像素光线，其余片段丢弃，
+  // 保留目标纹理中单光线的结果。丢弃后通过的片段数即本帧的超采样像素数
+  if (texelFetch(supersampleMask, ivec2(gl_FragCoord.xy), 0).r <= supersampleThreshold) {
+    discard;
+  }
+  vec3 sum = vec3(0.0);
+  for (int i = 0; i < SUPERSAMPLE_RAYS; i++) {
+    sum += traceRay(pos, rayDirection(view, fragCoord + SUPERSAMPLE_OFFSETS[i], screenSize),
+                    escape);
+  }
+  fragColor = vec4(sum / float(SUPERSAMPLE_RAYS), 1.0);
+  return;
+#endif
+
+#if LENSING_MAP == 2 && COARSE_TO_FINE != 1
+  // 不经过吸积盘的像素只有天空盒随时间旋转，按缓存的逃逸方向采样即可。
+  // 穿越吸积盘次数不多的像素只从缓存的穿越处重新积分盘内的一段
+  vec4 lensing = texelFetch(lensingMap, ivec2(gl_FragCoord.xy), 0);
+  bool throughDisk = lensing.a > 0.25;
+  if (lensing.a < 0.75 && (!throughDisk || DISK_CROSSING_CACHE != 0)) {
+    vec3 cached = octDecode(lensing.rg * 2.0 - 1.0);
+    vec3 color = lensing.b > 0.0 ? skyColor(cached, lensing.b) : vec3(0.0);
+    if (throughDisk) {
+      vec4 crossing = texelFetch(diskCrossings1, ivec2(gl_FragCoord.xy), 0);
+      color += crossing != vec4(0.0) ? shadeDiskCrossing(pos, dir, crossing) : vec3(0.0);
+      crossing = texelFetch(diskCrossings2, ivec2(gl_FragCoord.xy), 0);
+      color += crossing != vec4(0.0) ? shadeDiskCrossing(pos, dir, crossing) : vec3(0.0);
+    }
+    // 吸积盘像素对时间累积仍标记为动态
+    fragColor = vec4(color, throughDisk ? 1.0 : 0.0);
+    return;
+  }
+#endif
+
+#if COARSE_TO_FINE == 2 && LENSING_MAP != 1
+  vec3 interpolated;
+  if (interpolateCoarse(fragCoord, interpolated)) {
+    fragColor = vec4(interpolated, 0.0);
+    return;
+  }
+#endif
 
-  fragColor.rgb = traceColor(pos, dir); // 计算片段颜色
+#if TEMPORAL_ACCUMULATION && LENSING_MAP != 1
+  vec4 reused;
+  if (reuseHistory(dir, fragCoord, screenSize, reused)) {
+    fragColor = reused;
+    return;
+  }
+#endif
+
+  fragColor.rgb = traceRay(pos, dir, escape);
+
+#if ADISK_BOUNDS_DEBUG
+  fragColor.rgb = vec3(adiskSkipped, adiskEvaluated, 0.0) / maxSteps;
+#endif
+#if COARSE_TO_FINE == 2 && COARSE_DEBUG
+  fragColor.rgb = mix(fragColor.rgb, vec3(1.0, 0.0, 0.0), 0.5);
+#endif
+#if TEMPORAL_ACCUMULATION
+  // 光线进入过吸积盘包围体的像素标记为动态
+  fragColor.a = adiskEvaluated > 0 ? 1.0 : 0.0;
+#endif
+
+#if LENSING_MAP == 1
+  // 经过吸积盘的像素颜色随噪声流动：穿越次数超过上限的重新追踪，
+  // 其余按缓存的穿越着色
+  float diskState = diskCrossingCount > MAX_DISK_CROSSINGS ? 1.0
+                    : diskCrossingCount > 0                ? 0.5
+                                                           : 0.0;
+  fragColor = vec4(octEncode(escape.xyz) * 0.5 + 0.5, escape.w, diskState);
+  diskCrossingOutput1 = diskCrossingCount >= 1 ? diskCrossings[0] : vec4(0.0);
+  diskCrossingOutput2 = diskCrossingCount >= 2 ? diskCrossings[1] : vec4(0.0);
+#endif
+}
+
+void main() {
+  shade();
+#if BRIGHTNESS_OUTPUT
+  float brightness = dot(fragColor.rgb, vec3(0.2125, 0.7154, 0.0721));
+  brightColor = vec4(brightness > 1.0 ? fragColor.rgb : vec3(0.0), 1.0);
+#endif
 }
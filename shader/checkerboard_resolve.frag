@@ -0,0 +1,65 @@
+#version 330 core
+
+out vec4 fragColor;
+
+#ifndef BRIGHTNESS_OUTPUT
+#define BRIGHTNESS_OUTPUT 0 // 以第二个颜色附件同时输出Bloom亮部
+#endif
+#if BRIGHTNESS_OUTPUT
+layout(location = 1) out vec4 brightColor; // 亮度超过1的部分，与bloom_brightness_pass.frag一致
+#endif
+
+uniform sampler2D texture0; // 本帧追踪的半宽图像
+uniform sampler2D texture1; // 上一帧追踪的半宽图像，恰好是本帧缺失的另一半像素
+uniform vec2 resolution;    // 完整图像尺寸
+uniform float checkerboardParity = 0.0;
+uniform float historyValid = 0.0; // 参数或分辨率改变后上一帧不可用
+
+float luminance(vec3 color) { return dot(color, vec3(0.2126, 0.7152, 0.0722)); }
+
+// 完整图像坐标p处本帧追踪的颜色，p须满足本帧的棋盘格奇偶
+vec3 current(ivec2 p) { return texelFetch(texture0, ivec2(p.x >> 1, p.y), 0).rgb; }
+
+// 由棋盘格重建完整图像：本帧追踪的像素直接取用；缺失的像素取上一帧
+// 在同一位置追踪的颜色，并钳制到四邻域的范围内，抑制运动和吸积盘流动
+// 造成的拖影；没有上一帧时沿亮度差较小的方向插值
+void resolve() {
+  ivec2 p = ivec2(gl_FragCoord.xy);
+  ivec2 size = ivec2(resolution);
+  int parity = int(checkerboardParity);
+  if (((p.x + p.y + parity) & 1) == 0) {
+    fragColor = vec4(current(p), 1.0);
+    return;
+  }
+
+  // 四邻域都是本帧追踪的像素；边界处用对侧邻居代替
+  ivec2 left = ivec2(p.x > 0 ? p.x - 1 : p.x + 1, p.y);
+  ivec2 right = ivec2(p.x + 1 < size.x ? p.x + 1 : p.x - 1, p.y);
+  ivec2 down = ivec2(p.x, p.y > 0 ? p.y - 1 : p.y + 1);
+  ivec2 up = ivec2(p.x, p.y + 1 < size.y ? p.y + 1 : p.y - 1);
+  vec3 l = current(left);
+  vec3 r = current(right);
+  vec3 d = current(down);
+  vec3 u = current(up);
+
+  vec3 color;
+  if (historyValid > 0.5) {
+    vec3 previous = texelFetch(texture1, ivec2(p.x >> 1, p.y), 0).rgb;
+    vec3 lo = min(min(l, r), min(d, u));
+    vec3 hi = max(max(l, r), max(d, u));
+    color = clamp(previous, lo, hi);
+  } else {
+    float horizontal = abs(luminance(l) - luminance(r));
+    float vertical = abs(luminance(d) - luminance(u));
+    color = horizontal < vertical ? 0.5 * (l + r) : 0.5 * (d + u);
+  }
+  fragColor = vec4(color, 1.0);
+}
+
+void main() {
+  resolve();
+#if BRIGHTNESS_OUTPUT
+  float brightness = dot(fragColor.rgb, vec3(0.2125, 0.7154, 0.0721));
+  brightColor = vec4(brightness > 1.0 ? fragColor.rgb : vec3(0.0), 1.0);
+#endif
+}
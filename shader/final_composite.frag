@@ -0,0 +1,41 @@
+#version 330 core
+
+in vec2 uv;
+
+out vec4 fragColor;
+
+uniform sampler2D texture0; // 场景
+uniform sampler2D texture1; // Bloom
+uniform vec2 resolution;
+
+// 与bloom_composite.frag和tonemapping.frag的参数一致
+uniform float tone = 1.0;
+uniform float bloomStrength = 0.1;
+uniform float tonemappingEnabled;
+uniform float gamma = 2.2;
+
+///----
+/// Narkowicz 2015, "ACES Filmic Tone Mapping Curve"
+vec3 aces(vec3 x) {
+  const float a = 2.51;
+  const float b = 0.03;
+  const float c = 2.43;
+  const float d = 0.59;
+  const float e = 0.14;
+  return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
+}
+///----
+
+// 合并Bloom、色调映射和输出的最终通道：直接写入默认帧缓冲，
+// 省去bloomFinal和tonemapped两张全分辨率中间纹理的读写
+void main() {
+  fragColor = texture(texture0, uv) * tone + texture(texture1, uv) * bloomStrength;
+
+  if (tonemappingEnabled > 0.5) {
+    // ACES filmic tone mapping
+    fragColor.rgb = aces(fragColor.rgb);
+
+    // Gamma correction
+    fragColor.rgb = pow(fragColor.rgb, vec3(1.0 / gamma));
+  }
+}
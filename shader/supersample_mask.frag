@@ -0,0 +1,31 @@
+#version 330 core
+
+out vec4 fragColor;
+
+uniform sampler2D texture0; // 单光线追踪的结果
+uniform vec2 resolution;    // 视口分辨率（像素），与texture0中有效区域一致
+
+// 压缩HDR亮度，吸积盘高亮区的微小起伏不会被当作边缘
+float compressedLuminance(vec3 color) {
+  float luma = dot(color, vec3(0.2126, 0.7152, 0.0722));
+  return luma / (1.0 + luma);
+}
+
+// 自适应超采样的对比度预通道：输出3x3邻域的亮度差，
+// 光子环、吸积盘内缘和阴影边界处接近1，平滑区域接近0
+void main() {
+  ivec2 center = ivec2(gl_FragCoord.xy);
+  ivec2 maxTexel = ivec2(resolution) - 1;
+
+  float minLuma = 1.0;
+  float maxLuma = 0.0;
+  for (int y = -1; y <= 1; y++) {
+    for (int x = -1; x <= 1; x++) {
+      ivec2 p = clamp(center + ivec2(x, y), ivec2(0), maxTexel);
+      float luma = compressedLuminance(texelFetch(texture0, p, 0).rgb);
+      minLuma = min(minLuma, luma);
+      maxLuma = max(maxLuma, luma);
+    }
+  }
+  fragColor = vec4(maxLuma - minLuma, 0.0, 0.0, 1.0);
+}
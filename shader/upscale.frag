@@ -0,0 +1,52 @@
+#version 330 core
+
+in vec2 uv;
+
+out vec4 fragColor;
+
+#ifndef BRIGHTNESS_OUTPUT
+#define BRIGHTNESS_OUTPUT 0 // 以第二个颜色附件同时输出Bloom亮部
+#endif
+#if BRIGHTNESS_OUTPUT
+layout(location = 1) out vec4 brightColor; // 亮度超过1的部分，与bloom_brightness_pass.frag一致
+#endif
+
+uniform sampler2D texture0; // 低分辨率图像，位于纹理左下角
+uniform float sourceWidth;  // 实际渲染区域（像素）
+uniform float sourceHeight;
+
+// 边缘保持强度，越大越接近最近邻
+const float EDGE_SHARPNESS = 8.0;
+
+float luminance(vec3 color) { return dot(color, vec3(0.2126, 0.7152, 0.0722)); }
+
+// 边缘感知的双线性放大：以最近的源像素为参考，亮度相对差异大的邻居降权，
+// 平滑区域退化为双线性，黑洞边缘和吸积盘轮廓两侧不互相渗色
+void main() {
+  vec2 sourceSize = vec2(sourceWidth, sourceHeight);
+  vec2 p = uv * sourceSize - 0.5;
+  vec2 f = fract(p);
+  ivec2 base = ivec2(floor(p));
+  ivec2 maxTexel = ivec2(sourceSize) - 1;
+
+  vec3 c00 = texelFetch(texture0, clamp(base, ivec2(0), maxTexel), 0).rgb;
+  vec3 c10 = texelFetch(texture0, clamp(base + ivec2(1, 0), ivec2(0), maxTexel), 0).rgb;
+  vec3 c01 = texelFetch(texture0, clamp(base + ivec2(0, 1), ivec2(0), maxTexel), 0).rgb;
+  vec3 c11 = texelFetch(texture0, clamp(base + ivec2(1, 1), ivec2(0), maxTexel), 0).rgb;
+
+  vec4 l = vec4(luminance(c00), luminance(c10), luminance(c01), luminance(c11));
+  float reference = f.y < 0.5 ? (f.x < 0.5 ? l.x : l.y) : (f.x < 0.5 ? l.z : l.w);
+
+  vec4 w = vec4((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y),
+                (1.0 - f.x) * f.y, f.x * f.y);
+  // HDR 下使用相对差异
+  vec4 difference = abs(l - reference) / (l + reference + 1e-3);
+  w *= exp(-EDGE_SHARPNESS * difference);
+
+  vec3 color = (c00 * w.x + c10 * w.y + c01 * w.z + c11 * w.w) / dot(w, vec4(1.0));
+  fragColor = vec4(color, 1.0);
+#if BRIGHTNESS_OUTPUT
+  float brightness = dot(color, vec3(0.2125, 0.7154, 0.0721));
+  brightColor = vec4(brightness > 1.0 ? color : vec3(0.0), 1.0);
+#endif
+}
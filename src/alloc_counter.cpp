@@ -0,0 +1,46 @@
+#include "alloc_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+// 替换全局 operator new/delete，按线程统计分配次数
+static thread_local uint64_t allocationCount = 0;
+
+uint64_t threadAllocationCount() { return allocationCount; }
+
+static void *countedAlloc(std::size_t size) {
+  allocationCount++;
+  void *p = std::malloc(size ? size : 1);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new(std::size_t size) { return countedAlloc(size); }
+
+void *operator new[](std::size_t size) { return countedAlloc(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+  allocationCount++;
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+  allocationCount++;
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete[](void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, const std::nothrow_t &) noexcept { std::free(p); }
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
@@ -0,0 +1,17 @@
+#ifndef ALLOC_COUNTER_H
+#define ALLOC_COUNTER_H
+
+#include <cstdint>
+
+// 当前线程累计的堆分配次数（operator new 调用次数）。
+// 取两次读数之差即可得到一段代码内的分配次数，其他线程的分配不计入
+uint64_t threadAllocationCount();
+
+// 执行 run 并把其间的分配次数累加到 total，用于统计不连续的几段代码
+template <typename Run> void countAllocations(uint64_t &total, Run &&run) {
+  uint64_t before = threadAllocationCount();
+  run();
+  total += threadAllocationCount() - before;
+}
+
+#endif /* ALLOC_COUNTER_H */
@@ -0,0 +1,215 @@
+#include "bloom_benchmark.h"
+#include "compute_bloom.h" // 计算着色器Bloom
+
+#include <algorithm> // std::max
+#include <cstdlib> // std::abs
+#include <iomanip> // std::setw
+
+static double levelPixels(int width, int height, int level) {
+    return (double)std::max(1, width >> level) * std::max(1, height >> level);
+}
+
+static double toMegabytes(double pixels, GLenum format) {
+    return pixels * bytesPerPixel(format) / (1024.0 * 1024.0);
+}
+
+// 片段着色器链：下采样第l级读第l级、写第l+1级（第0级为亮部），
+// 上采样读下一级和同级、写同级
+static double fragmentTraffic(int width, int height, int iterations, GLenum format) {
+    double pixels = 0.0;
+    for (int level = 0; level < iterations; level++) {
+        pixels += levelPixels(width, height, level) + levelPixels(width, height, level + 1);
+    }
+    for (int level = iterations - 1; level >= 0; level--) {
+        pixels += levelPixels(width, height, level + 1) + 2.0 * levelPixels(width, height, level);
+    }
+    return toMegabytes(pixels, format);
+}
+
+// 计算着色器链：每次下采样调度读一级、写两级，中间一级不再读回
+static double computeTraffic(int width, int height, int iterations, GLenum format) {
+    double pixels = 0.0;
+    for (int k = 0; k < iterations; k += 2) {
+        pixels += levelPixels(width, height, k) + levelPixels(width, height, k + 1);
+        if (k + 2 <= iterations) {
+            pixels += levelPixels(width, height, k + 2);
+        }
+    }
+    for (int level = iterations - 1; level >= 0; level--) {
+        pixels += levelPixels(width, height, level + 1) + 2.0 * levelPixels(width, height, level);
+    }
+    return toMegabytes(pixels, format);
+}
+
+// 与帧图中声明的Bloom链相同，down[l] 为第l+1级，up[l] 为第l级
+static void runFragmentChain(const BloomPasses& passes, GLuint brightness,
+    const std::vector<GLuint>& down, const std::vector<GLuint>& up, int width, int height,
+    int iterations) {
+    for (int level = 0; level < iterations; level++) {
+        RenderPass& pass = passes.downsamplePasses[level];
+        pass.setTexture(passes.downsampleInputs[level], level == 0 ? brightness : down[level - 1]);
+        pass.setTarget(down[level], width >> (level + 1), height >> (level + 1));
+        pass.execute();
+    }
+    GLuint lower = down[iterations - 1];
+    for (int level = iterations - 1; level >= 0; level--) {
+        RenderPass& pass = passes.upsamplePasses[level];
+        pass.setTexture(passes.upsampleInputs[level], lower);
+        pass.setTexture(passes.upsampleSkipInputs[level], level == 0 ? brightness : down[level - 1]);
+        pass.setTarget(up[level], width >> level, height >> level);
+        pass.execute();
+        lower = up[level];
+    }
+}
+
+// 重复执行并返回单次的平均GPU耗时（毫秒）。用时间戳而不是 GL_TIME_ELAPSED，
+// 被测的代码内部可能有自己的计时查询，后者不能嵌套
+template <typename Run>
+static float measure(int repetitions, Run run) {
+    run(); // 预热：首次执行时编译程序、创建帧缓冲
+    GLuint queries[2];
+    glGenQueries(2, queries);
+    glQueryCounter(queries[0], GL_TIMESTAMP);
+    for (int i = 0; i < repetitions; i++) {
+        run();
+    }
+    glQueryCounter(queries[1], GL_TIMESTAMP);
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+    glDeleteQueries(2, queries);
+    return (float)((end - begin) * 1e-6 / repetitions);
+}
+
+// 按当前的合成参数（Bloom强度、色调映射、Gamma）合成到8位纹理并读回
+static void composeAndRead(const BloomPasses& passes, GLuint scene, GLuint bloom,
+    GLuint target, int width, int height, std::vector<unsigned char>& image) {
+    RenderPass& pass = *passes.finalPass;
+    pass.setTexture(passes.finalScene, scene);
+    pass.setTexture(passes.finalBloom, bloom);
+    pass.setTarget(target, width, height);
+    pass.execute();
+
+    image.resize((size_t)width * height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindTexture(GL_TEXTURE_2D, target);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+static void compareImages(const std::vector<unsigned char>& image,
+    const std::vector<unsigned char>& reference, BloomChainResult& result) {
+    size_t pixelCount = image.size() / 4;
+    long long sum = 0;
+    size_t differing = 0;
+    for (size_t i = 0; i < pixelCount; i++) {
+        int pixelMax = 0;
+        for (int c = 0; c < 3; c++) {
+            int difference = std::abs((int)image[4 * i + c] - (int)reference[4 * i + c]);
+            pixelMax = std::max(pixelMax, difference);
+            sum += difference;
+        }
+        result.maxDifference = std::max(result.maxDifference, pixelMax);
+        differing += pixelMax > 1 ? 1 : 0;
+    }
+    result.meanDifference = pixelCount ? sum / (3.0 * pixelCount) : 0.0;
+    result.differingPixels = pixelCount ? (double)differing / pixelCount : 0.0;
+}
+
+std::vector<BloomFormatResult> benchmarkBloomFormats(const BloomPasses& passes, GLuint scene,
+    GLuint brightness, int width, int height, int iterations,
+    const std::vector<GLenum>& formats, int repetitions) {
+    // 亮部先转换为被测格式，与帧图中亮部纹理使用Bloom格式时一致
+    static RenderPass copyPass = [] {
+        RenderPassInfo info;
+        info.fragShader = "shader/passthrough.frag";
+        return RenderPass(info);
+    }();
+    static int copyInput = copyPass.addTexture("texture0");
+    // 独立的金字塔，不影响帧图中导入的那张
+    static ComputeBloom computeBloom;
+
+    GLuint composed = createColorTexture(width, height, GL_RGBA8);
+    std::vector<unsigned char> image;
+    std::vector<unsigned char> fragmentReference, computeReference;
+
+    std::vector<BloomFormatResult> results;
+    for (GLenum format : formats) {
+        BloomFormatResult result;
+        result.format = format;
+
+        GLuint converted = createColorTexture(width, height, format);
+        copyPass.setTexture(copyInput, brightness);
+        copyPass.setTarget(converted, width, height);
+        copyPass.execute();
+
+        std::vector<GLuint> down(iterations), up(iterations);
+        for (int level = 0; level < iterations; level++) {
+            down[level] = createColorTexture(width >> (level + 1), height >> (level + 1), format);
+            up[level] = createColorTexture(width >> level, height >> level, format);
+        }
+        result.fragment.supported = true;
+        result.fragment.milliseconds = measure(repetitions, [&] {
+            runFragmentChain(passes, converted, down, up, width, height, iterations);
+        });
+        result.fragment.megabytes = fragmentTraffic(width, height, iterations, format);
+        composeAndRead(passes, scene, up[0], composed, width, height, image);
+        if (fragmentReference.empty()) {
+            fragmentReference = image;
+        }
+        compareImages(image, fragmentReference, result.fragment);
+        for (int level = 0; level < iterations; level++) {
+            destroyColorTexture(down[level]);
+            destroyColorTexture(up[level]);
+        }
+
+        // 图像读写只支持 RGBA16F 和 R11F_G11F_B10F，ComputeBloom 会替换其他格式
+        if (ComputeBloom::supported() &&
+            (format == GL_RGBA16F || format == GL_R11F_G11F_B10F)) {
+            computeBloom.resize(width, height, iterations, format);
+            result.compute.supported = true;
+            result.compute.milliseconds = measure(repetitions, [&] {
+                computeBloom.execute(converted, iterations);
+            });
+            result.compute.megabytes = computeTraffic(width, height, iterations, format);
+            composeAndRead(passes, scene, computeBloom.texture(), composed, width, height, image);
+            if (computeReference.empty()) {
+                computeReference = image;
+            }
+            compareImages(image, computeReference, result.compute);
+        }
+
+        destroyColorTexture(converted);
+        results.push_back(result);
+    }
+    destroyColorTexture(composed);
+    return results;
+}
+
+static void printChain(std::ostream& out, const char* name, const BloomChainResult& chain) {
+    out << "  " << std::left << std::setw(10) << name << std::right;
+    if (!chain.supported) {
+        out << " n/a" << std::endl;
+        return;
+    }
+    out << std::setw(8) << chain.milliseconds << " ms " << std::setw(8) << chain.megabytes
+        << " MiB/frame   max diff " << std::setw(3) << chain.maxDifference << ", mean "
+        << std::setprecision(3) << chain.meanDifference << std::setprecision(2) << ", "
+        << chain.differingPixels * 100.0 << "% px > 1" << std::endl;
+}
+
+void printBloomBenchmark(std::ostream& out, const std::vector<BloomFormatResult>& results) {
+    if (results.empty()) {
+        return;
+    }
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << "bloom formats (difference in 8-bit output vs "
+        << internalFormatName(results[0].format) << "):" << std::endl;
+    for (const BloomFormatResult& result : results) {
+        out << internalFormatName(result.format) << std::endl;
+        printChain(out, "fragment", result.fragment);
+        printChain(out, "compute", result.compute);
+    }
+    out << std::defaultfloat << std::setprecision(precision);
+}
@@ -0,0 +1,52 @@
+#ifndef BLOOM_BENCHMARK_H
+#define BLOOM_BENCHMARK_H
+
+#include <ostream>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "render.h"
+
+// Bloom链用到的片段着色器通道，与帧图中的相同。finalPass 把场景与Bloom
+// 合成为输出图像，用于比较各格式最终可见的差异
+struct BloomPasses {
+  RenderPass *downsamplePasses;
+  const int *downsampleInputs;
+  RenderPass *upsamplePasses;
+  const int *upsampleInputs;
+  const int *upsampleSkipInputs;
+  RenderPass *finalPass;
+  int finalScene;
+  int finalBloom;
+};
+
+struct BloomChainResult {
+  bool supported = false;
+  float milliseconds = 0.0f; // 整条Bloom链的平均GPU耗时
+  double megabytes = 0.0;    // 估算的每帧显存读写量，不计纹理缓存的重复命中
+  // 与参照格式合成后的8位输出之差（按通道）
+  int maxDifference = 0;
+  double meanDifference = 0.0;
+  double differingPixels = 0.0; // 任一通道相差超过1个色阶的像素比例
+};
+
+struct BloomFormatResult {
+  GLenum format;
+  BloomChainResult fragment;
+  BloomChainResult compute;
+};
+
+// 对同一帧的亮部和场景，按 formats 中的每种中间纹理格式分别执行片段着色器
+// 和计算着色器的Bloom链：重复 repetitions 次取平均GPU耗时，并以第一种格式
+// （应为 GL_RGBA16F）的合成结果为参照比较输出图像。会阻塞到GPU完成，
+// 只用于手动触发的测量
+std::vector<BloomFormatResult>
+benchmarkBloomFormats(const BloomPasses &passes, GLuint scene, GLuint brightness,
+                      int width, int height, int iterations,
+                      const std::vector<GLenum> &formats, int repetitions = 32);
+
+void printBloomBenchmark(std::ostream &out,
+                         const std::vector<BloomFormatResult> &results);
+
+#endif /* BLOOM_BENCHMARK_H */
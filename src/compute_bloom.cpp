@@ -0,0 +1,114 @@
+#include "compute_bloom.h"
+#include "shader.h" // 着色器管理头文件
+
+#include <algorithm> // std::max, std::min
+
+// 与着色器中的 local_size 一致
+static const int DOWNSAMPLE_GROUP_SIZE = 16;
+static const int UPSAMPLE_GROUP_SIZE = 8;
+
+static int groupCount(int size, int groupSize) {
+    return (size + groupSize - 1) / groupSize;
+}
+
+bool ComputeBloom::supported() {
+    return GLEW_VERSION_4_3 != 0;
+}
+
+void ComputeBloom::resize(int width, int height, int levels, GLenum format) {
+    if (format != GL_R11F_G11F_B10F) {
+        format = GL_RGBA16F;
+    }
+    if (format != pyramidFormat) {
+        if (downsampleProgram) {
+            glDeleteProgram(downsampleProgram);
+            glDeleteProgram(upsampleProgram);
+        }
+        // 图像的格式限定符须与纹理的内部格式一致
+        ShaderDefines defines = { { "BLOOM_IMAGE_FORMAT",
+            format == GL_R11F_G11F_B10F ? "r11f_g11f_b10f" : "rgba16f" } };
+        downsampleProgram = createComputeProgram("shader/bloom_downsample.comp", defines);
+        upsampleProgram = createComputeProgram("shader/bloom_upsample.comp", defines);
+
+        glUseProgram(downsampleProgram);
+        glUniform1i(glGetUniformLocation(downsampleProgram, "inputTexture"), 0);
+        inputLodLocation = glGetUniformLocation(downsampleProgram, "inputLod");
+        secondLevelEnabledLocation = glGetUniformLocation(downsampleProgram, "secondLevelEnabled");
+        glUseProgram(upsampleProgram);
+        glUniform1i(glGetUniformLocation(upsampleProgram, "pyramid"), 0);
+        glUniform1i(glGetUniformLocation(upsampleProgram, "skipTexture"), 1);
+        lowerLodLocation = glGetUniformLocation(upsampleProgram, "lowerLod");
+        skipFromTargetLocation = glGetUniformLocation(upsampleProgram, "skipFromTarget");
+        glUseProgram(0);
+    }
+
+    levels = std::min(levels, MAX_LEVELS);
+    if (pyramid && width == this->width && height == this->height && levels == this->levels &&
+        format == pyramidFormat) {
+        return;
+    }
+    if (pyramid) {
+        destroyColorTexture(pyramid);
+    }
+    this->width = width;
+    this->height = height;
+    this->levels = levels;
+    pyramidFormat = format;
+
+    // 不可变存储，每一级都能单独绑定为图像
+    glGenTextures(1, &pyramid);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glTexStorage2D(GL_TEXTURE_2D, levels + 1, format, width, height);
+    // textureLod 按指定级别双线性采样；合成通道按1:1采样，取到第0级
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void ComputeBloom::execute(GLuint brightness, int iterations) {
+    iterations = std::min(iterations, levels);
+    // 每次调度之后，下一次调度要采样或读写刚写入的级别
+    const GLbitfield barrier = GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+
+    // 下采样：第k级（第0次为亮部纹理） -> 第k+1、k+2级
+    glUseProgram(downsampleProgram);
+    for (int k = 0; k < iterations; k += 2) {
+        bool second = k + 2 <= iterations;
+        downsampleTimers[k / 2].begin();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, k == 0 ? brightness : pyramid);
+        glUniform1f(inputLodLocation, k == 0 ? 0.0f : (float)k);
+        glUniform1i(secondLevelEnabledLocation, second ? 1 : 0);
+        glBindImageTexture(0, pyramid, k + 1, GL_FALSE, 0, GL_WRITE_ONLY, pyramidFormat);
+        glBindImageTexture(1, pyramid, second ? k + 2 : k + 1, GL_FALSE, 0, GL_WRITE_ONLY,
+            pyramidFormat);
+        int firstWidth = std::max(1, width >> (k + 1));
+        int firstHeight = std::max(1, height >> (k + 1));
+        glDispatchCompute(groupCount(firstWidth, DOWNSAMPLE_GROUP_SIZE),
+            groupCount(firstHeight, DOWNSAMPLE_GROUP_SIZE), 1);
+        glMemoryBarrier(barrier);
+        downsampleTimers[k / 2].end();
+    }
+
+    // 上采样：第l+1级放大后加到第l级上，第0级的同级结果为亮部纹理
+    glUseProgram(upsampleProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, brightness);
+    for (int level = iterations - 1; level >= 0; level--) {
+        upsampleTimers[level].begin();
+        glUniform1f(lowerLodLocation, (float)(level + 1));
+        glUniform1i(skipFromTargetLocation, level > 0 ? 1 : 0);
+        glBindImageTexture(0, pyramid, level, GL_FALSE, 0, GL_READ_WRITE, pyramidFormat);
+        int levelWidth = std::max(1, width >> level);
+        int levelHeight = std::max(1, height >> level);
+        glDispatchCompute(groupCount(levelWidth, UPSAMPLE_GROUP_SIZE),
+            groupCount(levelHeight, UPSAMPLE_GROUP_SIZE), 1);
+        glMemoryBarrier(barrier);
+        upsampleTimers[level].end();
+    }
+    glUseProgram(0);
+}
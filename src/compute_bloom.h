@@ -0,0 +1,56 @@
+#ifndef COMPUTE_BLOOM_H
+#define COMPUTE_BLOOM_H
+
+#include <GL/glew.h>
+
+#include "render.h"
+
+// 计算着色器实现的Bloom金字塔（GL 4.3）。所有级别存放在一张带mipmap的
+// 纹理中：第k级为第k次下采样的结果，上采样原地覆盖，最后第0级为
+// 最终的Bloom。下采样每次调度借助共享内存生成两级
+class ComputeBloom {
+public:
+  static const int MAX_LEVELS = 8;
+
+  // 当前上下文是否支持计算着色器
+  static bool supported();
+
+  // 尺寸、级数或格式改变时重新创建金字塔纹理，格式改变时重新编译程序。
+  // 图像读写不支持三通道的 GL_RGB16F，除 GL_R11F_G11F_B10F 外一律用 GL_RGBA16F
+  void resize(int width, int height, int levels,
+              GLenum format = GL_R11F_G11F_B10F);
+
+  // 由全分辨率亮部纹理生成 iterations 级（不超过 resize 的 levels）的Bloom
+  void execute(GLuint brightness, int iterations);
+
+  GLuint texture() const { return pyramid; }
+  GLenum format() const { return pyramidFormat; }
+
+  // 第pair次下采样调度（生成第 2*pair+1 和 2*pair+2 级）的GPU耗时
+  float downsampleMilliseconds(int pair) const {
+    return downsampleTimers[pair].milliseconds();
+  }
+  // 生成第level级上采样结果的GPU耗时
+  float upsampleMilliseconds(int level) const {
+    return upsampleTimers[level].milliseconds();
+  }
+
+private:
+  GLuint downsampleProgram = 0;
+  GLuint upsampleProgram = 0;
+  GLint inputLodLocation = -1;
+  GLint secondLevelEnabledLocation = -1;
+  GLint lowerLodLocation = -1;
+  GLint skipFromTargetLocation = -1;
+
+  GLuint pyramid = 0;
+  GLenum pyramidFormat = 0;
+  int width = 0;
+  int height = 0;
+  int levels = 0; // 下采样级数，纹理共有 levels + 1 个mip
+
+  GpuTimer downsampleTimers[(MAX_LEVELS + 1) / 2];
+  GpuTimer upsampleTimers[MAX_LEVELS];
+};
+
+#endif /* COMPUTE_BLOOM_H */
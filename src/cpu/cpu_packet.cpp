@@ -0,0 +1,131 @@
+#include "cpu_packet.h" // 光线包内核头文件
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h> // __cpuid / _xgetbv
+#endif
+
+// 标量版本的追踪函数，按uniform选择积分方式
+static glm::vec3 traceColorScalar(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    if (u.planarOrbit > 0.5f) {
+        return traceColorPlanar(u, pos, dir);
+    }
+    if (u.adaptiveStep > 0.5f) {
+        return traceColorAdaptive(u, pos, dir);
+    }
+    return traceColor(u, pos, dir);
+}
+
+// 标量内核：逐条调用traceColor()，作为各SIMD内核的参照
+static void tracePacketScalar(const TracerUniforms& u, RayPacket& rp) {
+    for (int i = 0; i < rp.count; i++) {
+        glm::vec3 pos = glm::vec3(rp.px[i], rp.py[i], rp.pz[i]);
+        glm::vec3 dir = glm::vec3(rp.dx[i], rp.dy[i], rp.dz[i]);
+        glm::vec3 color = traceColorScalar(u, pos, dir);
+        rp.r[i] = color.r;
+        rp.g[i] = color.g;
+        rp.b[i] = color.b;
+    }
+}
+
+static const RayPacketKernel scalarKernel = { "scalar", SimdLevel::Scalar, 1,
+                                              tracePacketScalar };
+
+void packetDiskSample(const TracerUniforms& u, const float pos[3], float weight,
+    float color[3]) {
+    glm::vec3 c = glm::vec3(0.0f);
+    float alpha = 1.0f;
+    adiskColor(u, glm::vec3(pos[0], pos[1], pos[2]), c, alpha);
+    color[0] += c.r * weight;
+    color[1] += c.g * weight;
+    color[2] += c.b * weight;
+}
+
+void packetSkySample(const TracerUniforms& u, const float dir[3], float color[3]) {
+    glm::vec3 c = skyColor(u, glm::vec3(dir[0], dir[1], dir[2]));
+    color[0] += c.r;
+    color[1] += c.g;
+    color[2] += c.b;
+}
+
+void packetTraceScalar(const TracerUniforms& u, const float pos[3], const float dir[3],
+    float color[3]) {
+    glm::vec3 c = traceColorScalar(u, glm::vec3(pos[0], pos[1], pos[2]),
+        glm::vec3(dir[0], dir[1], dir[2]));
+    color[0] = c.r;
+    color[1] = c.g;
+    color[2] = c.b;
+}
+
+void packetEscapeDirection(const TracerUniforms& u, const float pos[3], float dir[3]) {
+    glm::vec3 d = asymptoticDirection(u, glm::vec3(pos[0], pos[1], pos[2]),
+        glm::vec3(dir[0], dir[1], dir[2]));
+    dir[0] = d.x;
+    dir[1] = d.y;
+    dir[2] = d.z;
+}
+
+// 运行时检测CPU指令集，AVX系列还需确认操作系统保存了对应寄存器状态
+SimdLevel detectSimdLevel() {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1")) {
+        return SimdLevel::SSE4;
+    }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0;
+    bool avx512f = (info[1] & (1 << 16)) != 0;
+
+    if (avx512f && (xcr0 & 0xE6) == 0xE6) { // XMM/YMM/opmask/ZMM状态
+        return SimdLevel::AVX512;
+    }
+    if (avx && avx2 && fma && (xcr0 & 0x6) == 0x6) { // XMM/YMM状态
+        return SimdLevel::AVX2;
+    }
+    if (sse41) {
+        return SimdLevel::SSE4;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+std::vector<const RayPacketKernel*> availablePacketKernels() {
+    SimdLevel cpuLevel = detectSimdLevel();
+
+    std::vector<const RayPacketKernel*> kernels;
+    kernels.push_back(&scalarKernel);
+    for (const RayPacketKernel* kernel :
+        { packetKernelSSE4(), packetKernelAVX2(), packetKernelAVX512() }) {
+        if (kernel && kernel->level <= cpuLevel) {
+            kernels.push_back(kernel);
+        }
+    }
+    return kernels;
+}
+
+const RayPacketKernel& selectPacketKernel(SimdLevel maxLevel) {
+    static const std::vector<const RayPacketKernel*> kernels =
+        availablePacketKernels();
+
+    const RayPacketKernel* best = &scalarKernel;
+    for (const RayPacketKernel* kernel : kernels) {
+        if (kernel->level <= maxLevel) {
+            best = kernel;
+        }
+    }
+    return *best;
+}
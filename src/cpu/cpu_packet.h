@@ -0,0 +1,59 @@
+#ifndef CPU_PACKET_H
+#define CPU_PACKET_H
+
+#include <vector>
+
+#include "cpu_tracer.h"
+
+// 一个光线包最多容纳的光线数（AVX-512 一次处理 16 条）
+#define RAY_PACKET_MAX 16
+
+// 数组结构体（SoA）形式的光线包，dir 为未缩放的单位方向
+struct RayPacket {
+  float px[RAY_PACKET_MAX], py[RAY_PACKET_MAX], pz[RAY_PACKET_MAX];
+  float dx[RAY_PACKET_MAX], dy[RAY_PACKET_MAX], dz[RAY_PACKET_MAX];
+  float r[RAY_PACKET_MAX], g[RAY_PACKET_MAX], b[RAY_PACKET_MAX];
+  int count; // 有效光线数，不超过内核宽度
+};
+
+enum class SimdLevel { Scalar, SSE4, AVX2, AVX512 };
+
+// 对一个光线包执行 traceColor()，结果写回 r/g/b
+struct RayPacketKernel {
+  const char *name;
+  SimdLevel level;
+  int width;
+  void (*trace)(const TracerUniforms &u, RayPacket &packet);
+};
+
+// 当前 CPU 支持的最高指令集
+SimdLevel detectSimdLevel();
+
+// 返回不超过 maxLevel 且已编译、CPU 支持的最宽内核
+const RayPacketKernel &selectPacketKernel(SimdLevel maxLevel = SimdLevel::AVX512);
+
+// 所有可在当前 CPU 上运行的内核，按宽度从小到大排列
+std::vector<const RayPacketKernel *> availablePacketKernels();
+
+// 供各指令集内核调用的逐光线回调，参数为普通数组以免在特定指令集的
+// 编译单元中实例化 glm 的内联函数；weight 为该步步长与 STEP_SIZE 之比
+void packetDiskSample(const TracerUniforms &u, const float pos[3], float weight,
+                      float color[3]);
+
+void packetSkySample(const TracerUniforms &u, const float dir[3],
+                     float color[3]);
+
+// 对单条光线调用标量版本的追踪函数，用于 SIMD 内核无法处理的光线
+void packetTraceScalar(const TracerUniforms &u, const float pos[3],
+                       const float dir[3], float color[3]);
+
+// 对提前逃逸的光线调用 asymptoticDirection()，dir 原地更新
+void packetEscapeDirection(const TracerUniforms &u, const float pos[3],
+                           float dir[3]);
+
+// 各指令集编译单元提供的内核，编译器不支持时返回 nullptr
+const RayPacketKernel *packetKernelSSE4();
+const RayPacketKernel *packetKernelAVX2();
+const RayPacketKernel *packetKernelAVX512();
+
+#endif /* CPU_PACKET_H */
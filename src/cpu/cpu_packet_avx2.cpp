@@ -0,0 +1,50 @@
+#include "cpu_packet.h" // 光线包内核头文件
+
+// AVX2 + FMA内核，一次处理8条光线
+#if defined(__AVX2__)
+
+#include <immintrin.h> // AVX2/FMA
+
+#include "cpu_packet_kernel.h" // SIMD模板
+
+struct SimdAVX2 {
+    enum { W = 8 };
+    typedef __m256 F;
+    typedef __m256 M;
+
+    static F set1(float x) { return _mm256_set1_ps(x); }
+    static F load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, F x) { _mm256_storeu_ps(p, x); }
+    static F add(F a, F b) { return _mm256_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm256_div_ps(a, b); }
+    static F sqrt(F a) { return _mm256_sqrt_ps(a); }
+    static F fmadd(F a, F b, F c) { return _mm256_fmadd_ps(a, b, c); }
+    static F min(F a, F b) { return _mm256_min_ps(a, b); }
+    static F max(F a, F b) { return _mm256_max_ps(a, b); }
+    static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static M lt(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static M le(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+    static M andMask(M a, M b) { return _mm256_and_ps(a, b); }
+    static M andNotMask(M a, M b) { return _mm256_andnot_ps(a, b); } // ~a & b
+    static M orMask(M a, M b) { return _mm256_or_ps(a, b); }
+    static F maskz(M m, F a) { return _mm256_and_ps(m, a); }
+    static F select(M m, F a, F b) { return _mm256_blendv_ps(b, a, m); } // m ? a : b
+    static unsigned bits(M m) { return (unsigned)_mm256_movemask_ps(m); }
+    static M firstLanes(int n) {
+        return _mm256_cmp_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7),
+            _mm256_set1_ps((float)n), _CMP_LT_OQ);
+    }
+};
+
+static const RayPacketKernel kernel = { "avx2", SimdLevel::AVX2, SimdAVX2::W,
+                                        tracePacketSimd<SimdAVX2> };
+
+const RayPacketKernel* packetKernelAVX2() { return &kernel; }
+
+#else
+
+const RayPacketKernel* packetKernelAVX2() { return nullptr; }
+
+#endif
@@ -0,0 +1,47 @@
+#include "cpu_packet.h" // 光线包内核头文件
+
+// AVX-512F内核，一次处理16条光线，通道掩码直接使用k寄存器
+#if defined(__AVX512F__)
+
+#include <immintrin.h> // AVX-512F
+
+#include "cpu_packet_kernel.h" // SIMD模板
+
+struct SimdAVX512 {
+    enum { W = 16 };
+    typedef __m512 F;
+    typedef __mmask16 M;
+
+    static F set1(float x) { return _mm512_set1_ps(x); }
+    static F load(const float* p) { return _mm512_loadu_ps(p); }
+    static void store(float* p, F x) { _mm512_storeu_ps(p, x); }
+    static F add(F a, F b) { return _mm512_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm512_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm512_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm512_div_ps(a, b); }
+    static F sqrt(F a) { return _mm512_sqrt_ps(a); }
+    static F fmadd(F a, F b, F c) { return _mm512_fmadd_ps(a, b, c); }
+    static F min(F a, F b) { return _mm512_min_ps(a, b); }
+    static F max(F a, F b) { return _mm512_max_ps(a, b); }
+    static F abs(F a) { return _mm512_abs_ps(a); }
+    static M lt(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static M le(F a, F b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+    static M andMask(M a, M b) { return (M)(a & b); }
+    static M andNotMask(M a, M b) { return (M)(~a & b); }
+    static M orMask(M a, M b) { return (M)(a | b); }
+    static F maskz(M m, F a) { return _mm512_maskz_mov_ps(m, a); }
+    static F select(M m, F a, F b) { return _mm512_mask_blend_ps(m, b, a); } // m ? a : b
+    static unsigned bits(M m) { return (unsigned)m; }
+    static M firstLanes(int n) { return (M)((1u << n) - 1u); }
+};
+
+static const RayPacketKernel kernel = { "avx512", SimdLevel::AVX512,
+                                        SimdAVX512::W, tracePacketSimd<SimdAVX512> };
+
+const RayPacketKernel* packetKernelAVX512() { return &kernel; }
+
+#else
+
+const RayPacketKernel* packetKernelAVX512() { return nullptr; }
+
+#endif
@@ -0,0 +1,508 @@
+#ifndef CPU_PACKET_KERNEL_H
+#define CPU_PACKET_KERNEL_H
+
+// traceColor() 主循环的 SIMD 模板，只能被 cpu_packet_<isa>.cpp 包含。
+// 模板参数 S 封装一种指令集：
+//   S::W, S::F, S::M
+//   set1/load/store/add/sub/mul/div/sqrt/fmadd/min/max/abs
+//   lt/le, andMask/andNotMask/orMask, maskz, select, bits, firstLanes
+// 这些编译单元带有 -mavx2 等选项，因此这里不能调用 glm 等内联函数。
+
+#include "cpu_packet.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+static inline int lowestLane(unsigned bits) {
+  unsigned long index;
+  _BitScanForward(&index, bits);
+  return (int)index;
+}
+static inline int laneCount(unsigned bits) { return (int)__popcnt(bits); }
+#else
+static inline int lowestLane(unsigned bits) { return __builtin_ctz(bits); }
+static inline int laneCount(unsigned bits) { return __builtin_popcount(bits); }
+#endif
+
+// 小角度（|d| <= 0.1）的 cos/sin 多项式，误差约 1e-11，用于在 SIMD 中旋转方位角
+template <typename S>
+static void rotateAngle(typename S::F &c, typename S::F &s, typename S::F d) {
+  typedef typename S::F F;
+  F d2 = S::mul(d, d);
+  F sinD = S::mul(d, S::fmadd(S::mul(d2, S::set1(-1.0f / 6.0f)),
+                              S::fmadd(d2, S::set1(-1.0f / 20.0f), S::set1(1.0f)),
+                              S::set1(1.0f)));
+  F cosD = S::fmadd(
+      S::mul(d2, S::set1(-0.5f)),
+      S::fmadd(S::mul(d2, S::set1(-1.0f / 12.0f)),
+               S::fmadd(d2, S::set1(-1.0f / 30.0f), S::set1(1.0f)), S::set1(1.0f)),
+      S::set1(1.0f));
+  F c2 = S::sub(S::mul(c, cosD), S::mul(s, sinD));
+  s = S::fmadd(c, sinD, S::mul(s, cosD));
+  c = c2;
+}
+
+// 比奈方程的四阶龙格-库塔单步，与 cpu_tracer.cpp 中的 binetStep() 相同
+template <typename S>
+static void binetStepSimd(typename S::F k, typename S::F dphi, typename S::F &x,
+                          typename S::F &dx) {
+  typedef typename S::F F;
+  F half = S::mul(dphi, S::set1(0.5f));
+  auto f = [k](F v) { return S::sub(S::mul(S::mul(k, v), v), v); };
+  F k1x = dx, k1v = f(x);
+  F k2x = S::fmadd(half, k1v, dx), k2v = f(S::fmadd(half, k1x, x));
+  F k3x = S::fmadd(half, k2v, dx), k3v = f(S::fmadd(half, k2x, x));
+  F k4x = S::fmadd(dphi, k3v, dx), k4v = f(S::fmadd(dphi, k3x, x));
+  F sixth = S::mul(dphi, S::set1(1.0f / 6.0f));
+  F two = S::set1(2.0f);
+  x = S::fmadd(sixth, S::add(S::add(k1x, k4x), S::mul(two, S::add(k2x, k3x))), x);
+  dx = S::fmadd(sixth, S::add(S::add(k1v, k4v), S::mul(two, S::add(k2v, k3v))), dx);
+}
+
+// traceColorPlanar() 的 SIMD 版本。方位角以 (cos(phi), sin(phi)) 表示，
+// 每步用 rotateAngle() 旋转，因此这里不需要三角函数
+template <typename S>
+static void tracePacketPlanarSimd(const TracerUniforms &u, RayPacket &rp) {
+  typedef typename S::F F;
+  typedef typename S::M M;
+
+  const bool adisk = u.adiskEnabled > 0.5f;
+  const F zero = S::set1(0.0f);
+  const F one = S::set1(1.0f);
+  const F k = S::set1(u.gravatationalLensing > 0.5f ? 1.5f : 0.0f);
+  const F stepSize = S::set1(0.1f);
+  const F maxDphi = S::set1(0.1f);
+  const F diskHeight = S::set1(u.adiskHeight);
+  const F diskOuter = S::set1(12.0f);
+  const F invR2 = S::set1(1.0f / (12.0f * 12.0f));
+  const F invH2 = S::set1(1.0f / (u.adiskHeight * u.adiskHeight));
+  const F diskBound = S::set1(0.9981f);
+  const bool earlyEscape = u.earlyEscape > 0.5f;
+  const F escapeU = S::set1(1.0f / escapeRadius(u));
+
+  // 轨道平面的正交基：e1 指向初始位置，e2 为与之垂直的切向
+  F px = S::load(rp.px), py = S::load(rp.py), pz = S::load(rp.pz);
+  F dx = S::load(rp.dx), dy = S::load(rp.dy), dz = S::load(rp.dz);
+  F r0 = S::sqrt(S::fmadd(px, px, S::fmadd(py, py, S::mul(pz, pz))));
+  F e1x = S::div(px, r0), e1y = S::div(py, r0), e1z = S::div(pz, r0);
+  F cosAlpha = S::fmadd(dx, e1x, S::fmadd(dy, e1y, S::mul(dz, e1z)));
+  F tx = S::sub(dx, S::mul(cosAlpha, e1x));
+  F ty = S::sub(dy, S::mul(cosAlpha, e1y));
+  F tz = S::sub(dz, S::mul(cosAlpha, e1z));
+  F sinAlpha = S::sqrt(S::fmadd(tx, tx, S::fmadd(ty, ty, S::mul(tz, tz))));
+  F safeSin = S::max(sinAlpha, S::set1(0.0001f));
+  F e2x = S::div(tx, safeSin), e2y = S::div(ty, safeSin), e2z = S::div(tz, safeSin);
+
+  // 径向光线的轨道平面不确定，交给标量版本
+  M lanes = S::firstLanes(rp.count);
+  M radial = S::andMask(S::le(sinAlpha, S::set1(0.0001f)), lanes);
+  M running = S::andNotMask(radial, lanes); // 仍在积分
+  M alive = running;                        // 未落入事件视界
+  M inside = S::andMask(running, S::lt(one, zero));
+
+  F x = S::div(one, r0);
+  F dxdphi = S::div(S::mul(S::sub(zero, x), cosAlpha), safeSin); // du/dphi
+  F c = one, s = zero;
+  F fx = zero, fy = zero, fz = zero; // 逃逸光线的最终方向
+  F ex = zero, ey = zero, ez = zero; // 提前逃逸光线的位置
+  M flying = running;                // 未提前逃逸
+
+  // 到吸积盘所在区域的距离下界，在区域内时不大于 0
+  auto diskDistance = [&](F cc, F ss, F xx) {
+    F y = S::div(S::fmadd(e1y, cc, S::mul(e2y, ss)), xx);
+    return S::max(S::sub(S::abs(y), diskHeight), S::sub(S::div(one, xx), diskOuter));
+  };
+
+  alignas(64) float lanePos[3][RAY_PACKET_MAX];
+  for (int i = rp.count; i < S::W; i++) {
+    rp.r[i] = rp.g[i] = rp.b[i] = 0.0f;
+  }
+  for (int i = 0; i < rp.count; i++) {
+    rp.r[i] = rp.g[i] = rp.b[i] = 0.0f;
+  }
+
+  for (int i = 0; i < int(u.maxSteps) && S::bits(running); i++) {
+    // 位于逃逸半径外且向外运动（du/dphi < 0）的通道逃逸，与 isEscaping() 一致
+    if (earlyEscape) {
+      M escaped = S::andMask(S::andMask(S::lt(x, escapeU), S::lt(dxdphi, zero)), running);
+      if (S::bits(escaped)) {
+        F rx = S::fmadd(e1x, c, S::mul(e2x, s));
+        F ry = S::fmadd(e1y, c, S::mul(e2y, s));
+        F rz = S::fmadd(e1z, c, S::mul(e2z, s));
+        F nx = S::sub(S::mul(e2x, c), S::mul(e1x, s));
+        F ny = S::sub(S::mul(e2y, c), S::mul(e1y, s));
+        F nz = S::sub(S::mul(e2z, c), S::mul(e1z, s));
+        ex = S::select(escaped, S::div(rx, x), ex);
+        ey = S::select(escaped, S::div(ry, x), ey);
+        ez = S::select(escaped, S::div(rz, x), ez);
+        fx = S::select(escaped, S::sub(S::mul(nx, x), S::mul(rx, dxdphi)), fx);
+        fy = S::select(escaped, S::sub(S::mul(ny, x), S::mul(ry, dxdphi)), fy);
+        fz = S::select(escaped, S::sub(S::mul(nz, x), S::mul(rz, dxdphi)), fz);
+        flying = S::andNotMask(escaped, flying);
+        running = S::andNotMask(escaped, running);
+        if (!S::bits(running)) {
+          break;
+        }
+      }
+    }
+
+    F slope = S::div(dxdphi, x);
+    F phiPerLength = S::div(x, S::sqrt(S::fmadd(slope, slope, one)));
+    F dphi = maxDphi;
+    if (adisk) {
+      M sampling = S::andMask(inside, running);
+      if (S::bits(sampling)) {
+        F qx = S::div(S::fmadd(e1x, c, S::mul(e2x, s)), x);
+        F qy = S::div(S::fmadd(e1y, c, S::mul(e2y, s)), x);
+        F qz = S::div(S::fmadd(e1z, c, S::mul(e2z, s)), x);
+        // 与 tracePacketSimd() 相同的密度预判
+        F q = S::fmadd(S::fmadd(qx, qx, S::mul(qz, qz)), invR2,
+                       S::mul(S::mul(qy, qy), invH2));
+        sampling = S::andMask(S::le(q, diskBound), sampling);
+        S::store(lanePos[0], qx);
+        S::store(lanePos[1], qy);
+        S::store(lanePos[2], qz);
+      }
+      unsigned sampleLanes = S::bits(sampling);
+      if (u.diskCounters) {
+        countDiskSamples(u, laneCount(sampleLanes),
+                         laneCount(S::bits(S::andNotMask(sampling, running))));
+      }
+      if (sampleLanes) {
+        while (sampleLanes) {
+          int lane = lowestLane(sampleLanes);
+          sampleLanes &= sampleLanes - 1;
+          float pos[3] = {lanePos[0][lane], lanePos[1][lane], lanePos[2][lane]};
+          float color[3] = {rp.r[lane], rp.g[lane], rp.b[lane]};
+          packetDiskSample(u, pos, 1.0f, color);
+          rp.r[lane] = color[0];
+          rp.g[lane] = color[1];
+          rp.b[lane] = color[2];
+        }
+      }
+      F outside = S::min(
+          dphi, S::mul(S::max(diskDistance(c, s, x), stepSize), phiPerLength));
+      dphi = S::select(inside, S::mul(stepSize, phiPerLength), outside);
+    }
+    dphi = S::maskz(running, dphi); // 停止的通道保持不变
+
+    F x0 = x, dx0 = dxdphi;
+    binetStepSimd<S>(k, dphi, x, dxdphi);
+
+    // 落入事件视界的通道退出，颜色保持不变
+    M captured = S::andMask(S::le(one, x), running);
+    alive = S::andNotMask(captured, alive);
+    running = S::andNotMask(captured, running);
+
+    // 逃逸的通道在 u = 0 处插值出最终方向
+    M escaped = S::andMask(S::le(x, zero), running);
+    if (S::bits(escaped)) {
+      F frac = S::div(x0, S::max(S::sub(x0, x), S::set1(1e-20f)));
+      F ce = c, se = s;
+      rotateAngle<S>(ce, se, S::maskz(escaped, S::mul(dphi, frac)));
+      fx = S::select(escaped, S::fmadd(e1x, ce, S::mul(e2x, se)), fx);
+      fy = S::select(escaped, S::fmadd(e1y, ce, S::mul(e2y, se)), fy);
+      fz = S::select(escaped, S::fmadd(e1z, ce, S::mul(e2z, se)), fz);
+      running = S::andNotMask(escaped, running);
+    }
+
+    if (adisk) {
+      F c1 = c, s1 = s;
+      rotateAngle<S>(c1, s1, dphi);
+      M entering = S::andMask(S::andNotMask(inside, running),
+                              S::le(diskDistance(c1, s1, x), zero));
+      if (S::bits(entering)) {
+        // 二分求出进入区域的方位角，退回到该处
+        F lo = zero, hi = dphi;
+        F invDphi = S::div(one, S::max(dphi, S::set1(1e-20f)));
+        for (int j = 0; j < 8; j++) {
+          F mid = S::mul(S::add(lo, hi), S::set1(0.5f));
+          F t = S::mul(mid, invDphi);
+          F t2 = S::mul(t, t), t3 = S::mul(t2, t);
+          F h00 = S::add(S::sub(S::mul(S::set1(2.0f), t3), S::mul(S::set1(3.0f), t2)), one);
+          F h10 = S::add(S::sub(t3, S::mul(S::set1(2.0f), t2)), t);
+          F h01 = S::sub(S::mul(S::set1(3.0f), t2), S::mul(S::set1(2.0f), t3));
+          F h11 = S::sub(t3, t2);
+          F xm = S::fmadd(h00, x0, S::fmadd(S::mul(h10, dphi), dx0,
+                                            S::fmadd(h01, x, S::mul(S::mul(h11, dphi), dxdphi))));
+          F cm = c, sm = s;
+          rotateAngle<S>(cm, sm, mid);
+          M in = S::le(diskDistance(cm, sm, xm), zero);
+          hi = S::select(in, mid, hi);
+          lo = S::select(in, lo, mid);
+        }
+        dphi = S::select(entering, hi, dphi);
+        F xe = x0, dxe = dx0;
+        binetStepSimd<S>(k, dphi, xe, dxe);
+        x = S::select(entering, xe, x);
+        dxdphi = S::select(entering, dxe, dxdphi);
+        c1 = c;
+        s1 = s;
+        rotateAngle<S>(c1, s1, dphi);
+      }
+      M stay = S::andMask(inside, S::le(diskDistance(c1, s1, x), zero));
+      inside = S::andMask(S::orMask(entering, stay), running);
+      c = c1;
+      s = s1;
+    }
+    else {
+      rotateAngle<S>(c, s, dphi);
+    }
+  }
+
+  // 步数用尽的通道按当前切向采样天空盒
+  if (S::bits(running)) {
+    F nx = S::sub(S::mul(e2x, c), S::mul(e1x, s));
+    F ny = S::sub(S::mul(e2y, c), S::mul(e1y, s));
+    F nz = S::sub(S::mul(e2z, c), S::mul(e1z, s));
+    F rx = S::fmadd(e1x, c, S::mul(e2x, s));
+    F ry = S::fmadd(e1y, c, S::mul(e2y, s));
+    F rz = S::fmadd(e1z, c, S::mul(e2z, s));
+    fx = S::select(running, S::sub(S::mul(nx, x), S::mul(rx, dxdphi)), fx);
+    fy = S::select(running, S::sub(S::mul(ny, x), S::mul(ry, dxdphi)), fy);
+    fz = S::select(running, S::sub(S::mul(nz, x), S::mul(rz, dxdphi)), fz);
+  }
+
+  // 提前逃逸的通道先补上剩余偏折
+  alignas(64) float finalDir[3][RAY_PACKET_MAX];
+  alignas(64) float escapePos[3][RAY_PACKET_MAX];
+  S::store(finalDir[0], fx);
+  S::store(finalDir[1], fy);
+  S::store(finalDir[2], fz);
+  S::store(escapePos[0], ex);
+  S::store(escapePos[1], ey);
+  S::store(escapePos[2], ez);
+  unsigned escapedLanes =
+      u.escapeCorrection > 0.5f ? S::bits(S::andNotMask(flying, alive)) : 0;
+  unsigned skyLanes = S::bits(alive);
+  while (skyLanes) {
+    int lane = lowestLane(skyLanes);
+    skyLanes &= skyLanes - 1;
+    float dir[3] = {finalDir[0][lane], finalDir[1][lane], finalDir[2][lane]};
+    if (escapedLanes & (1u << lane)) {
+      float pos[3] = {escapePos[0][lane], escapePos[1][lane], escapePos[2][lane]};
+      packetEscapeDirection(u, pos, dir);
+    }
+    float color[3] = {rp.r[lane], rp.g[lane], rp.b[lane]};
+    packetSkySample(u, dir, color);
+    rp.r[lane] = color[0];
+    rp.g[lane] = color[1];
+    rp.b[lane] = color[2];
+  }
+
+  unsigned radialLanes = S::bits(radial);
+  while (radialLanes) {
+    int lane = lowestLane(radialLanes);
+    radialLanes &= radialLanes - 1;
+    float pos[3] = {rp.px[lane], rp.py[lane], rp.pz[lane]};
+    float dir[3] = {rp.dx[lane], rp.dy[lane], rp.dz[lane]};
+    float color[3];
+    packetTraceScalar(u, pos, dir, color);
+    rp.r[lane] = color[0];
+    rp.g[lane] = color[1];
+    rp.b[lane] = color[2];
+  }
+}
+
+template <typename S>
+static void tracePacketSimd(const TracerUniforms &u, RayPacket &rp) {
+  typedef typename S::F F;
+  typedef typename S::M M;
+
+  if (u.planarOrbit > 0.5f && u.renderBlackHole > 0.5f) {
+    tracePacketPlanarSimd<S>(u, rp);
+    return;
+  }
+
+  // 补齐不足一个包的空余通道，避免对未初始化数据做运算
+  for (int i = rp.count; i < S::W; i++) {
+    rp.px[i] = rp.px[0];
+    rp.py[i] = rp.py[0];
+    rp.pz[i] = rp.pz[0];
+    rp.dx[i] = rp.dx[0];
+    rp.dy[i] = rp.dy[0];
+    rp.dz[i] = rp.dz[0];
+  }
+  for (int i = 0; i < S::W; i++) {
+    rp.r[i] = rp.g[i] = rp.b[i] = 0.0f;
+  }
+
+  // 统一按单位方向积分。固定步长模式为 dir += a * dt, pos += dir * dt，
+  // dt 恒为 STEP_SIZE，与 traceColor() 在数学上等价；自适应模式与
+  // traceColorAdaptive() 一样使用蛙跳法
+  F px = S::load(rp.px), py = S::load(rp.py), pz = S::load(rp.pz);
+  F dx = S::load(rp.dx), dy = S::load(rp.dy), dz = S::load(rp.dz);
+
+  // h = cross(pos, dir)，h2 在整个积分过程中不变
+  F hx = S::sub(S::mul(py, dz), S::mul(pz, dy));
+  F hy = S::sub(S::mul(pz, dx), S::mul(px, dz));
+  F hz = S::sub(S::mul(px, dy), S::mul(py, dx));
+  F h2 = S::fmadd(hx, hx, S::fmadd(hy, hy, S::mul(hz, hz)));
+  F k = S::mul(S::set1(-1.5f), h2);
+
+  const bool renderBlackHole = u.renderBlackHole > 0.5f;
+  const bool lensing = u.gravatationalLensing > 0.5f;
+  const bool adisk = u.adiskEnabled > 0.5f;
+  const bool adaptive = u.adaptiveStep > 0.5f;
+  const bool earlyEscape = u.earlyEscape > 0.5f;
+  const int stepCount = adaptive ? int(u.maxSteps) : 300;
+
+  // adiskColor() 的第一次密度判断：length(pos / (R, H, R)) < 0.999，
+  // 这里取略宽的阈值，只负责筛掉不可能有贡献的通道
+  const F invR2 = S::set1(1.0f / (12.0f * 12.0f));
+  const F invH2 = S::set1(1.0f / (u.adiskHeight * u.adiskHeight));
+  const F diskBound = S::set1(0.9981f);
+  const F one = S::set1(1.0f);
+  const F half = S::set1(0.5f);
+
+  // adaptiveStepSize() 用到的常量
+  const F stepSize = S::set1(0.1f);
+  const F minStep = S::set1(0.01f);
+  const F twoTol = S::set1(2.0f * u.stepTolerance);
+  const F tinyAcc = S::set1(1e-8f);
+  const F diskHeight = S::set1(u.adiskHeight);
+  const F diskOuter = S::set1(12.0f);
+  const F maxPath = S::set1(30.0f);
+  const F escapeR2 = S::set1(escapeRadius(u) * escapeRadius(u));
+  const F zero = S::set1(0.0f);
+
+  M alive = S::firstLanes(rp.count); // 尚未落入事件视界
+  M flying = alive;                  // 尚未落入事件视界也未逃逸
+  F pathLength = S::set1(0.0f);
+  alignas(64) float lanePos[3][RAY_PACKET_MAX];
+  alignas(64) float laneStep[RAY_PACKET_MAX];
+
+  // 加速度系数 a = s * pos，s = -1.5 * h2 / r^5
+  F r2 = S::fmadd(px, px, S::fmadd(py, py, S::mul(pz, pz)));
+  F accScale = S::div(k, S::mul(S::mul(r2, r2), S::sqrt(r2)));
+
+  for (int i = 0; i < stepCount; i++) {
+    // 自适应模式下走完 MAX_PATH_LENGTH 的通道停止积分，但仍需采样天空盒
+    M running = adaptive ? S::andMask(S::lt(pathLength, maxPath), flying) : flying;
+    if (S::bits(running) == 0) {
+      break;
+    }
+
+    F dt = stepSize;
+    if (renderBlackHole) {
+      r2 = S::fmadd(px, px, S::fmadd(py, py, S::mul(pz, pz)));
+
+      // 落入事件视界的通道退出，颜色保持不变
+      M captured = S::lt(r2, one);
+      alive = S::andNotMask(captured, alive);
+      flying = S::andNotMask(captured, flying);
+      running = S::andNotMask(captured, running);
+
+      // 位于逃逸半径外且向外运动的通道逃逸，与 isEscaping() 一致
+      if (earlyEscape) {
+        F radial = S::fmadd(px, dx, S::fmadd(py, dy, S::mul(pz, dz)));
+        M escaped = S::andMask(S::lt(escapeR2, r2), S::lt(zero, radial));
+        flying = S::andNotMask(escaped, flying);
+        running = S::andNotMask(escaped, running);
+      }
+      if (S::bits(running) == 0) {
+        break;
+      }
+
+      if (adaptive) {
+        dt = S::mul(stepSize, S::sqrt(r2));
+        if (lensing) {
+          F accMag = S::div(S::mul(S::set1(1.5f), h2), S::mul(r2, r2));
+          dt = S::min(dt, S::sqrt(S::div(twoTol, S::max(accMag, tinyAcc))));
+        }
+        if (adisk) {
+          F rxz = S::sqrt(S::fmadd(px, px, S::mul(pz, pz)));
+          F diskDist = S::max(S::sub(S::abs(py), diskHeight), S::sub(rxz, diskOuter));
+          dt = S::min(dt, S::max(diskDist, stepSize));
+        }
+        dt = S::min(S::max(dt, minStep), S::sub(maxPath, pathLength));
+      }
+      dt = S::maskz(running, dt); // 停止的通道保持位置和方向不变
+
+      if (adisk) {
+        F q = S::fmadd(S::fmadd(px, px, S::mul(pz, pz)), invR2,
+                       S::mul(S::mul(py, py), invH2));
+        unsigned lanes = S::bits(S::andMask(S::le(q, diskBound), running));
+        if (u.diskCounters) {
+          int sampled = laneCount(lanes);
+          countDiskSamples(u, sampled, laneCount(S::bits(running)) - sampled);
+        }
+        if (lanes) {
+          S::store(lanePos[0], px);
+          S::store(lanePos[1], py);
+          S::store(lanePos[2], pz);
+          S::store(laneStep, S::div(dt, stepSize));
+          while (lanes) {
+            int lane = lowestLane(lanes);
+            lanes &= lanes - 1;
+            float pos[3] = {lanePos[0][lane], lanePos[1][lane],
+                            lanePos[2][lane]};
+            float color[3] = {rp.r[lane], rp.g[lane], rp.b[lane]};
+            packetDiskSample(u, pos, laneStep[lane], color);
+            rp.r[lane] = color[0];
+            rp.g[lane] = color[1];
+            rp.b[lane] = color[2];
+          }
+        }
+      }
+
+      if (lensing && adaptive) {
+        F s = S::mul(S::mul(accScale, dt), half);
+        dx = S::fmadd(s, px, dx);
+        dy = S::fmadd(s, py, dy);
+        dz = S::fmadd(s, pz, dz);
+        px = S::fmadd(dx, dt, px);
+        py = S::fmadd(dy, dt, py);
+        pz = S::fmadd(dz, dt, pz);
+        r2 = S::fmadd(px, px, S::fmadd(py, py, S::mul(pz, pz)));
+        accScale = S::div(k, S::mul(S::mul(r2, r2), S::sqrt(r2)));
+        s = S::mul(S::mul(accScale, dt), half);
+        dx = S::fmadd(s, px, dx);
+        dy = S::fmadd(s, py, dy);
+        dz = S::fmadd(s, pz, dz);
+        pathLength = S::add(pathLength, dt);
+        continue;
+      }
+
+      if (lensing) {
+        F s = S::mul(S::div(k, S::mul(S::mul(r2, r2), S::sqrt(r2))), dt);
+        dx = S::fmadd(s, px, dx);
+        dy = S::fmadd(s, py, dy);
+        dz = S::fmadd(s, pz, dz);
+      }
+    } else if (adaptive) {
+      dt = S::maskz(running, S::sub(maxPath, pathLength)); // 直线传播
+    }
+
+    px = S::fmadd(dx, dt, px);
+    py = S::fmadd(dy, dt, py);
+    pz = S::fmadd(dz, dt, pz);
+    pathLength = S::add(pathLength, dt);
+  }
+
+  // 未被捕获的通道采样天空盒，提前逃逸的通道先补上剩余偏折
+  S::store(rp.px, px);
+  S::store(rp.py, py);
+  S::store(rp.pz, pz);
+  S::store(rp.dx, dx);
+  S::store(rp.dy, dy);
+  S::store(rp.dz, dz);
+  unsigned escapedLanes =
+      u.escapeCorrection > 0.5f ? S::bits(S::andNotMask(flying, alive)) : 0;
+  unsigned lanes = S::bits(alive);
+  while (lanes) {
+    int lane = lowestLane(lanes);
+    lanes &= lanes - 1;
+    float dir[3] = {rp.dx[lane], rp.dy[lane], rp.dz[lane]};
+    if (escapedLanes & (1u << lane)) {
+      float pos[3] = {rp.px[lane], rp.py[lane], rp.pz[lane]};
+      packetEscapeDirection(u, pos, dir);
+    }
+    float color[3] = {rp.r[lane], rp.g[lane], rp.b[lane]};
+    packetSkySample(u, dir, color);
+    rp.r[lane] = color[0];
+    rp.g[lane] = color[1];
+    rp.b[lane] = color[2];
+  }
+}
+
+#endif /* CPU_PACKET_KERNEL_H */
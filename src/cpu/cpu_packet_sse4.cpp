@@ -0,0 +1,49 @@
+#include "cpu_packet.h" // 光线包内核头文件
+
+// SSE4.1内核，一次处理4条光线（x64上MSVC默认即可使用SSE4.1指令）
+#if defined(__SSE4_1__) || (defined(_MSC_VER) && defined(_M_X64))
+
+#include <smmintrin.h> // SSE4.1
+
+#include "cpu_packet_kernel.h" // SIMD模板
+
+struct SimdSSE4 {
+    enum { W = 4 };
+    typedef __m128 F;
+    typedef __m128 M;
+
+    static F set1(float x) { return _mm_set1_ps(x); }
+    static F load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, F x) { _mm_storeu_ps(p, x); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F sqrt(F a) { return _mm_sqrt_ps(a); }
+    static F fmadd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+    static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+    static M andMask(M a, M b) { return _mm_and_ps(a, b); }
+    static M andNotMask(M a, M b) { return _mm_andnot_ps(a, b); } // ~a & b
+    static M orMask(M a, M b) { return _mm_or_ps(a, b); }
+    static F maskz(M m, F a) { return _mm_and_ps(m, a); }
+    static F select(M m, F a, F b) { return _mm_blendv_ps(b, a, m); } // m ? a : b
+    static unsigned bits(M m) { return (unsigned)_mm_movemask_ps(m); }
+    static M firstLanes(int n) {
+        return _mm_cmplt_ps(_mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f), _mm_set1_ps((float)n));
+    }
+};
+
+static const RayPacketKernel kernel = { "sse4", SimdLevel::SSE4, SimdSSE4::W,
+                                        tracePacketSimd<SimdSSE4> };
+
+const RayPacketKernel* packetKernelSSE4() { return &kernel; }
+
+#else
+
+const RayPacketKernel* packetKernelSSE4() { return nullptr; }
+
+#endif
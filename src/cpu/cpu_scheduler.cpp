@@ -0,0 +1,190 @@
+#include "cpu_scheduler.h" // 分块调度头文件
+
+#include <algorithm> // 排序
+#include <atomic> // 原子计数
+#include <chrono> // 计时
+#include <cmath> // 对数分箱
+#include <deque> // 双端队列
+#include <fstream> // 文件输出
+#include <mutex> // 互斥锁
+#include <thread> // 工作线程
+
+// 将16位整数的各位间隔展开，用于计算Morton码
+static unsigned spreadBits(unsigned v) {
+    v &= 0xFFFF;
+    v = (v | (v << 8)) & 0x00FF00FF;
+    v = (v | (v << 4)) & 0x0F0F0F0F;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+}
+
+static unsigned mortonCode(unsigned x, unsigned y) {
+    return spreadBits(x) | (spreadBits(y) << 1);
+}
+
+// 每个线程一个队列，所有者从头部取，窃取者从尾部取
+struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<int> tiles;
+
+    bool popFront(int& tile) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tiles.empty()) {
+            return false;
+        }
+        tile = tiles.front();
+        tiles.pop_front();
+        return true;
+    }
+
+    bool popBack(int& tile) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tiles.empty()) {
+            return false;
+        }
+        tile = tiles.back();
+        tiles.pop_back();
+        return true;
+    }
+};
+
+void runTileScheduler(int width, int height, const TileSchedulerInfo& info,
+    const std::function<void(const Tile&)>& renderTile,
+    TileRenderStats* stats) {
+    auto start = std::chrono::steady_clock::now();
+
+    // 切块并按Morton顺序排列，使相邻的块在空间上也相邻
+    int tileSize = std::max(1, info.tileSize);
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    std::vector<Tile> tiles;
+    std::vector<unsigned> codes;
+    for (int ty = 0; ty < tilesY; ty++) {
+        for (int tx = 0; tx < tilesX; tx++) {
+            Tile tile;
+            tile.x = tx * tileSize;
+            tile.y = ty * tileSize;
+            tile.width = std::min(tileSize, width - tile.x);
+            tile.height = std::min(tileSize, height - tile.y);
+            tiles.push_back(tile);
+            codes.push_back(mortonCode(tx, ty));
+        }
+    }
+    std::vector<int> order(tiles.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = (int)i;
+    }
+    std::sort(order.begin(), order.end(),
+        [&](int a, int b) { return codes[a] < codes[b]; });
+
+    int threadCount = info.threadCount > 0 ? info.threadCount
+        : (int)std::thread::hardware_concurrency();
+    threadCount = std::max(1, std::min(threadCount, (int)tiles.size()));
+
+    // 每个线程先分到Morton序列中连续的一段
+    std::vector<WorkerQueue> queues(threadCount);
+    for (size_t i = 0; i < order.size(); i++) {
+        queues[i * threadCount / order.size()].tiles.push_back(order[i]);
+    }
+
+    std::vector<double> tileSeconds(tiles.size(), 0.0);
+    std::vector<int> tileWorker(tiles.size(), 0);
+    std::atomic<int> steals(0);
+
+    auto worker = [&](int id) {
+        unsigned seed = 2654435761u * (id + 1);
+        for (;;) {
+            int tile;
+            if (!queues[id].popFront(tile)) {
+                // 从随机位置开始依次尝试窃取，所有队列都为空时结束
+                seed = seed * 1664525u + 1013904223u;
+                int victim = (int)(seed % threadCount);
+                bool stolen = false;
+                for (int n = 0; n < threadCount && !stolen; n++) {
+                    int v = (victim + n) % threadCount;
+                    stolen = v != id && queues[v].popBack(tile);
+                }
+                if (!stolen) {
+                    return;
+                }
+                steals++;
+            }
+
+            auto tileStart = std::chrono::steady_clock::now();
+            renderTile(tiles[tile]);
+            std::chrono::duration<double> elapsed =
+                std::chrono::steady_clock::now() - tileStart;
+            tileSeconds[tile] = elapsed.count();
+            tileWorker[tile] = id;
+        }
+    };
+
+    // 调用线程也参与工作
+    std::vector<std::thread> threads;
+    for (int id = 1; id < threadCount; id++) {
+        threads.emplace_back(worker, id);
+    }
+    worker(0);
+    for (std::thread& t : threads) {
+        t.join();
+    }
+
+    if (stats) {
+        stats->tiles.clear();
+        for (int tile : order) {
+            stats->tiles.push_back({ tiles[tile], tileSeconds[tile], tileWorker[tile] });
+        }
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start;
+        stats->wallSeconds = wall.count();
+        stats->threadCount = threadCount;
+        stats->steals = steals;
+    }
+}
+
+bool writeTileCostCSV(const TileRenderStats& stats, const std::string& file) {
+    std::ofstream ofs(file);
+    if (!ofs.is_open()) {
+        return false;
+    }
+    ofs << "x,y,width,height,ms,worker\n";
+    for (const TileCost& cost : stats.tiles) {
+        ofs << cost.tile.x << "," << cost.tile.y << "," << cost.tile.width << ","
+            << cost.tile.height << "," << cost.seconds * 1000.0 << ","
+            << cost.worker << "\n";
+    }
+    return true;
+}
+
+bool writeTileHistogramCSV(const TileRenderStats& stats, const std::string& file,
+    int binCount) {
+    std::ofstream ofs(file);
+    if (!ofs.is_open() || stats.tiles.empty() || binCount < 1) {
+        return false;
+    }
+
+    // 块耗时跨越数个数量级（视界内的块几乎立即结束），因此按对数分箱
+    double minMs = 1e30, maxMs = 0.0;
+    for (const TileCost& cost : stats.tiles) {
+        double ms = std::max(cost.seconds * 1000.0, 1e-6);
+        minMs = std::min(minMs, ms);
+        maxMs = std::max(maxMs, ms);
+    }
+    double logMin = std::log(minMs);
+    double logRange = std::max(std::log(maxMs) - logMin, 1e-9);
+
+    std::vector<int> counts(binCount, 0);
+    for (const TileCost& cost : stats.tiles) {
+        double ms = std::max(cost.seconds * 1000.0, 1e-6);
+        int bin = (int)((std::log(ms) - logMin) / logRange * binCount);
+        counts[std::min(bin, binCount - 1)]++;
+    }
+
+    ofs << "bin_min_ms,bin_max_ms,count\n";
+    for (int i = 0; i < binCount; i++) {
+        ofs << std::exp(logMin + logRange * i / binCount) << ","
+            << std::exp(logMin + logRange * (i + 1) / binCount) << ","
+            << counts[i] << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef CPU_SCHEDULER_H
+#define CPU_SCHEDULER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+// 帧缓冲中的一个矩形块，坐标以左下角为原点
+struct Tile {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+struct TileCost {
+  Tile tile;
+  double seconds; // 追踪该块所用的时间
+  int worker;     // 执行该块的线程
+};
+
+struct TileRenderStats {
+  std::vector<TileCost> tiles; // 按 Morton 顺序排列
+  double wallSeconds = 0.0;
+  int threadCount = 0;
+  int steals = 0; // 从其他线程队列中窃取的块数
+};
+
+struct TileSchedulerInfo {
+  int tileSize = 32;
+  int threadCount = 0; // 0 表示使用全部硬件线程
+};
+
+// 将 width x height 的画面切成块，按 Morton 顺序分给各线程的双端队列，
+// 线程从自己队列的头部取块，空闲时从其他队列的尾部窃取
+void runTileScheduler(int width, int height, const TileSchedulerInfo &info,
+                      const std::function<void(const Tile &)> &renderTile,
+                      TileRenderStats *stats = nullptr);
+
+// 每块一行：x,y,width,height,ms,worker
+bool writeTileCostCSV(const TileRenderStats &stats, const std::string &file);
+
+// 按对数分箱的块耗时直方图：bin_min_ms,bin_max_ms,count
+bool writeTileHistogramCSV(const TileRenderStats &stats,
+                           const std::string &file, int binCount = 32);
+
+#endif /* CPU_SCHEDULER_H */
@@ -0,0 +1,147 @@
+#include "cpu_texture.h" // CPU纹理头文件
+
+#include <cmath> // 数学函数
+#include <iostream> // 输入输出流
+
+#include <stb_image.h> // 图像加载
+
+// sRGB到线性空间的转换，与GL_SRGB内部格式的解码规则一致
+static float srgbToLinear(float c) {
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// 将stb加载的像素转换为线性RGB texel
+static std::vector<glm::vec3> decodeTexels(const unsigned char* data, int width,
+    int height, int comp, bool srgb) {
+    std::vector<glm::vec3> texels(size_t(width) * height);
+    for (size_t i = 0; i < texels.size(); i++) {
+        const unsigned char* p = data + i * comp;
+        glm::vec3 c;
+        if (comp < 3) {
+            c = glm::vec3(p[0] / 255.0f, 0.0f, 0.0f); // 单通道对应GL_RED
+        }
+        else {
+            c = glm::vec3(p[0], p[1], p[2]) / 255.0f;
+        }
+        if (srgb) {
+            c = glm::vec3(srgbToLinear(c.r), srgbToLinear(c.g), srgbToLinear(c.b));
+        }
+        texels[i] = c;
+    }
+    return texels;
+}
+
+// 加载2D纹理，格式选择与loadTexture2D()相同
+CpuTexture2D loadTexture2DCPU(const std::string& file, bool repeat) {
+    CpuTexture2D tex;
+    tex.repeat = repeat;
+
+    int width, height, comp;
+    unsigned char* data = stbi_load(file.c_str(), &width, &height, &comp, 0);
+    if (data) {
+        tex.width = width;
+        tex.height = height;
+        tex.texels = decodeTexels(data, width, height, comp, comp >= 3); // 3/4通道为sRGB
+        stbi_image_free(data);
+    }
+    else {
+        std::cout << "ERROR: Failed to load texture at: " << file << std::endl;
+    }
+
+    return tex;
+}
+
+// 加载立方体贴图，缺失的面保持为空（采样结果为黑色）
+CpuCubemap loadCubemapCPU(const std::string& cubemapDir) {
+    const char* faces[6] = { "right", "left", "top", "bottom", "front", "back" };
+
+    CpuCubemap cubemap;
+    for (int i = 0; i < 6; i++) {
+        std::string path = cubemapDir + "/" + faces[i] + ".png";
+        int width, height, comp;
+        unsigned char* data = stbi_load(path.c_str(), &width, &height, &comp, 0);
+        if (data) {
+            cubemap.width = width;
+            cubemap.height = height;
+            cubemap.faces[i] = decodeTexels(data, width, height, comp, true);
+            stbi_image_free(data);
+        }
+        else {
+            std::cout << "Cubemap texture failed to load at path: " << path
+                << std::endl;
+        }
+    }
+
+    return cubemap;
+}
+
+// 按环绕模式取整数坐标
+static int wrapCoord(int i, int size, bool repeat) {
+    if (repeat) {
+        i %= size;
+        return i < 0 ? i + size : i;
+    }
+    return i < 0 ? 0 : (i >= size ? size - 1 : i);
+}
+
+// 双线性过滤，texel中心位于(i + 0.5) / size
+static glm::vec3 bilinear(const std::vector<glm::vec3>& texels, int width,
+    int height, bool repeat, glm::vec2 uv) {
+    float x = uv.x * width - 0.5f;
+    float y = uv.y * height - 0.5f;
+    float x0f = std::floor(x);
+    float y0f = std::floor(y);
+    float fx = x - x0f;
+    float fy = y - y0f;
+
+    int x0 = wrapCoord(int(x0f), width, repeat);
+    int x1 = wrapCoord(int(x0f) + 1, width, repeat);
+    int y0 = wrapCoord(int(y0f), height, repeat);
+    int y1 = wrapCoord(int(y0f) + 1, height, repeat);
+
+    glm::vec3 c00 = texels[size_t(y0) * width + x0];
+    glm::vec3 c10 = texels[size_t(y0) * width + x1];
+    glm::vec3 c01 = texels[size_t(y1) * width + x0];
+    glm::vec3 c11 = texels[size_t(y1) * width + x1];
+    return glm::mix(glm::mix(c00, c10, fx), glm::mix(c01, c11, fx), fy);
+}
+
+glm::vec3 sampleTexture2D(const CpuTexture2D& tex, glm::vec2 uv) {
+    if (tex.texels.empty()) {
+        return glm::vec3(0.0f);
+    }
+    return bilinear(tex.texels, tex.width, tex.height, tex.repeat, uv);
+}
+
+// 按OpenGL规范选择立方体贴图的面及面内坐标
+glm::vec3 sampleCubemap(const CpuCubemap& cubemap, glm::vec3 dir) {
+    glm::vec3 a = glm::abs(dir);
+    int face;
+    float sc, tc, ma;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = dir.x > 0.0f ? 0 : 1;
+        sc = dir.x > 0.0f ? -dir.z : dir.z;
+        tc = -dir.y;
+        ma = a.x;
+    }
+    else if (a.y >= a.z) {
+        face = dir.y > 0.0f ? 2 : 3;
+        sc = dir.x;
+        tc = dir.y > 0.0f ? dir.z : -dir.z;
+        ma = a.y;
+    }
+    else {
+        face = dir.z > 0.0f ? 4 : 5;
+        sc = dir.z > 0.0f ? dir.x : -dir.x;
+        tc = -dir.y;
+        ma = a.z;
+    }
+
+    const std::vector<glm::vec3>& texels = cubemap.faces[face];
+    if (texels.empty() || ma <= 0.0f) {
+        return glm::vec3(0.0f);
+    }
+
+    glm::vec2 st = (glm::vec2(sc, tc) / ma + 1.0f) * 0.5f;
+    return bilinear(texels, cubemap.width, cubemap.height, false, st);
+}
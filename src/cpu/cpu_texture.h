@@ -0,0 +1,33 @@
+#ifndef CPU_TEXTURE_H
+#define CPU_TEXTURE_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// CPU 端纹理，texel 已按 GL_SRGB 规则转换到线性空间，行序与 glTexImage2D 一致
+struct CpuTexture2D {
+  int width = 0;
+  int height = 0;
+  bool repeat = true;
+  std::vector<glm::vec3> texels;
+};
+
+// 面顺序与 loadCubemap() 相同：right, left, top, bottom, front, back
+struct CpuCubemap {
+  int width = 0;
+  int height = 0;
+  std::vector<glm::vec3> faces[6];
+};
+
+CpuTexture2D loadTexture2DCPU(const std::string &file, bool repeat = true);
+
+CpuCubemap loadCubemapCPU(const std::string &cubemapDir);
+
+// 等价于 GLSL texture()：双线性过滤，只采样第 0 级
+glm::vec3 sampleTexture2D(const CpuTexture2D &tex, glm::vec2 uv);
+
+glm::vec3 sampleCubemap(const CpuCubemap &cubemap, glm::vec3 dir);
+
+#endif /* CPU_TEXTURE_H */
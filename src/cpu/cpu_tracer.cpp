@@ -0,0 +1,800 @@
+#include "cpu_tracer.h" // CPU光线追踪头文件
+#include "cpu_packet.h" // 光线包内核
+#include "cpu_scheduler.h" // 分块调度
+
+#include <algorithm> // std::min
+#include <cmath> // 数学函数
+#include <iostream> // 输入输出流
+
+// 以下函数逐一移植自shader/blackhole_main.frag，修改着色器时需同步修改
+
+const float STEP_SIZE = 0.1f; // 固定步长
+const float MAX_PATH_LENGTH = 30.0f; // 300 * STEP_SIZE
+const float ADISK_OUTER_RADIUS = 12.0f; // 吸积盘外半径
+const float LUT_MIN_PERIAPSIS = 2.5f; // 近心点更靠近光子球的光线偏折角变化剧烈，不查表
+const float PLANAR_MAX_DPHI = 0.1f; // 轨道平面积分的最大方位角步长
+const float ADISK_INNER_RADIUS = 2.6f; // 吸积盘内半径，以内密度为0
+const float PHOTON_SPHERE_RADIUS = 1.5f; // 光子球半径 1.5 * rs
+const float CRITICAL_IMPACT_PARAMETER = 2.5980762f; // 3 * sqrt(3) * M，rs = 2M = 1
+
+// 按名字设置uniform
+bool setTracerUniform(TracerUniforms& u, const std::string& name, float value) {
+#define TRACER_UNIFORM(NAME)                                                   \
+  if (name == #NAME) {                                                         \
+    u.NAME = value;                                                            \
+    return true;                                                               \
+  }
+    TRACER_UNIFORM(mouseX);
+    TRACER_UNIFORM(mouseY);
+    TRACER_UNIFORM(time);
+    TRACER_UNIFORM(frontView);
+    TRACER_UNIFORM(topView);
+    TRACER_UNIFORM(cameraRoll);
+    TRACER_UNIFORM(gravatationalLensing);
+    TRACER_UNIFORM(renderBlackHole);
+    TRACER_UNIFORM(mouseControl);
+    TRACER_UNIFORM(fovScale);
+    TRACER_UNIFORM(adiskEnabled);
+    TRACER_UNIFORM(adiskParticle);
+    TRACER_UNIFORM(adiskHeight);
+    TRACER_UNIFORM(adiskLit);
+    TRACER_UNIFORM(adiskDensityV);
+    TRACER_UNIFORM(adiskDensityH);
+    TRACER_UNIFORM(adiskNoiseScale);
+    TRACER_UNIFORM(adiskNoiseLOD);
+    TRACER_UNIFORM(adiskSpeed);
+    TRACER_UNIFORM(adaptiveStep);
+    TRACER_UNIFORM(stepTolerance);
+    TRACER_UNIFORM(maxSteps);
+    TRACER_UNIFORM(earlyEscape);
+    TRACER_UNIFORM(escapeCorrection);
+    TRACER_UNIFORM(escapeRadius);
+    TRACER_UNIFORM(lensingLUT);
+    TRACER_UNIFORM(planarOrbit);
+    TRACER_UNIFORM(impactClassify);
+#undef TRACER_UNIFORM
+    return false;
+}
+
+// 将RenderToBufferInfo中的表解析为uniform结构体，行为与renderToTexture()一致
+TracerUniforms resolveTracerUniforms(const RenderToBufferInfo& rtbi) {
+    TracerUniforms u;
+    u.resolution = glm::vec2((float)rtbi.width, (float)rtbi.height); // 设置分辨率
+    u.time = rtbi.time; // 设置时间
+
+    // 更新浮点型Uniform变量
+    for (auto const& [name, val] : rtbi.floatUniforms) {
+        if (!setTracerUniform(u, name, val)) {
+            std::cout << "WARNING: uniform " << name << " is not found"
+                << std::endl;
+        }
+    }
+
+    // 更新纹理Uniform变量
+    for (auto const& [name, texture] : rtbi.textureUniforms) {
+        if (name == "colorMap") {
+            u.colorMap = texture;
+        }
+        else {
+            std::cout << "WARNING: uniform " << name << " is not found in shader"
+                << std::endl;
+        }
+    }
+    for (auto const& [name, texture] : rtbi.cubemapUniforms) {
+        if (name == "galaxy") {
+            u.galaxy = texture;
+        }
+        else {
+            std::cout << "WARNING: uniform " << name << " is not found in shader"
+                << std::endl;
+        }
+    }
+    u.deflectionLUT = rtbi.deflectionLUT;
+    u.diskCounters = rtbi.diskCounters;
+
+    return u;
+}
+
+///----
+/// Simplex 3D Noise
+/// 作者: Ian McEwan, Ashima Arts
+
+static glm::vec4 permute(glm::vec4 x) {
+    return glm::mod(((x * 34.0f) + 1.0f) * x, 289.0f);
+}
+
+static glm::vec4 taylorInvSqrt(glm::vec4 r) {
+    return 1.79284291400159f - 0.85373472095314f * r;
+}
+
+float snoise(glm::vec3 v) {
+    const glm::vec2 C = glm::vec2(1.0f / 6.0f, 1.0f / 3.0f);
+    const glm::vec4 D = glm::vec4(0.0f, 0.5f, 1.0f, 2.0f);
+
+    // 第一个顶点
+    glm::vec3 i = glm::floor(v + glm::dot(v, glm::vec3(C.y)));
+    glm::vec3 x0 = v - i + glm::dot(i, glm::vec3(C.x));
+
+    // 其他顶点
+    glm::vec3 g = glm::step(glm::vec3(x0.y, x0.z, x0.x), x0);
+    glm::vec3 l = 1.0f - g;
+    glm::vec3 lzxy = glm::vec3(l.z, l.x, l.y);
+    glm::vec3 i1 = glm::min(g, lzxy);
+    glm::vec3 i2 = glm::max(g, lzxy);
+
+    glm::vec3 x1 = x0 - i1 + 1.0f * C.x;
+    glm::vec3 x2 = x0 - i2 + 2.0f * C.x;
+    glm::vec3 x3 = x0 - 1.0f + 3.0f * C.x;
+
+    // 生成排列索引
+    i = glm::mod(i, 289.0f);
+    glm::vec4 p = permute(permute(permute(i.z + glm::vec4(0.0f, i1.z, i2.z, 1.0f)) +
+        i.y + glm::vec4(0.0f, i1.y, i2.y, 1.0f)) +
+        i.x + glm::vec4(0.0f, i1.x, i2.x, 1.0f));
+
+    // 生成梯度
+    float n_ = 1.0f / 7.0f; // N=7
+    glm::vec3 ns = n_ * glm::vec3(D.w, D.y, D.z) - glm::vec3(D.x, D.z, D.x);
+
+    glm::vec4 j = p - 49.0f * glm::floor(p * ns.z * ns.z); // mod(p,N*N)
+
+    glm::vec4 x_ = glm::floor(j * ns.z);
+    glm::vec4 y_ = glm::floor(j - 7.0f * x_); // mod(j,N)
+
+    glm::vec4 x = x_ * ns.x + ns.y;
+    glm::vec4 y = y_ * ns.x + ns.y;
+    glm::vec4 h = 1.0f - glm::abs(x) - glm::abs(y);
+
+    glm::vec4 b0 = glm::vec4(x.x, x.y, y.x, y.y);
+    glm::vec4 b1 = glm::vec4(x.z, x.w, y.z, y.w);
+
+    glm::vec4 s0 = glm::floor(b0) * 2.0f + 1.0f;
+    glm::vec4 s1 = glm::floor(b1) * 2.0f + 1.0f;
+    glm::vec4 sh = -glm::step(h, glm::vec4(0.0f));
+
+    glm::vec4 a0 = glm::vec4(b0.x, b0.z, b0.y, b0.w) +
+        glm::vec4(s0.x, s0.z, s0.y, s0.w) * glm::vec4(sh.x, sh.x, sh.y, sh.y);
+    glm::vec4 a1 = glm::vec4(b1.x, b1.z, b1.y, b1.w) +
+        glm::vec4(s1.x, s1.z, s1.y, s1.w) * glm::vec4(sh.z, sh.z, sh.w, sh.w);
+
+    glm::vec3 p0 = glm::vec3(a0.x, a0.y, h.x);
+    glm::vec3 p1 = glm::vec3(a0.z, a0.w, h.y);
+    glm::vec3 p2 = glm::vec3(a1.x, a1.y, h.z);
+    glm::vec3 p3 = glm::vec3(a1.z, a1.w, h.w);
+
+    // 归一化梯度
+    glm::vec4 norm = taylorInvSqrt(glm::vec4(glm::dot(p0, p0), glm::dot(p1, p1),
+        glm::dot(p2, p2), glm::dot(p3, p3)));
+    p0 *= norm.x;
+    p1 *= norm.y;
+    p2 *= norm.z;
+    p3 *= norm.w;
+
+    // 混合最终噪声值
+    glm::vec4 m = glm::max(0.6f - glm::vec4(glm::dot(x0, x0), glm::dot(x1, x1),
+        glm::dot(x2, x2), glm::dot(x3, x3)), 0.0f);
+    m = m * m;
+    return 42.0f * glm::dot(m * m, glm::vec4(glm::dot(p0, x0), glm::dot(p1, x1),
+        glm::dot(p2, x2), glm::dot(p3, x3)));
+}
+///----
+
+// 计算加速度，用于引力透镜效果
+static glm::vec3 accel(float h2, glm::vec3 pos) {
+    float r2 = glm::dot(pos, pos); // 位置向量的平方
+    float r5 = std::pow(r2, 2.5f); // r的5次方
+    return -1.5f * h2 * pos / r5;
+}
+
+// 根据轴和角度（角度制）生成四元数
+static glm::vec4 quadFromAxisAngle(glm::vec3 axis, float angle) {
+    float half_angle = (angle * 0.5f) * 3.14159f / 180.0f;
+    float s = std::sin(half_angle);
+    return glm::vec4(axis * s, std::cos(half_angle));
+}
+
+static glm::vec4 quadConj(glm::vec4 q) { return glm::vec4(-q.x, -q.y, -q.z, q.w); }
+
+static glm::vec4 quat_mult(glm::vec4 q1, glm::vec4 q2) {
+    glm::vec4 qr;
+    qr.x = (q1.w * q2.x) + (q1.x * q2.w) + (q1.y * q2.z) - (q1.z * q2.y);
+    qr.y = (q1.w * q2.y) - (q1.x * q2.z) + (q1.y * q2.w) + (q1.z * q2.x);
+    qr.z = (q1.w * q2.z) + (q1.x * q2.y) - (q1.y * q2.x) + (q1.z * q2.w);
+    qr.w = (q1.w * q2.w) - (q1.x * q2.x) - (q1.y * q2.y) - (q1.z * q2.z);
+    return qr;
+}
+
+// 使用四元数旋转向量
+static glm::vec3 rotateVector(glm::vec3 position, glm::vec3 axis, float angle) {
+    glm::vec4 qr = quadFromAxisAngle(axis, angle);
+    glm::vec4 qr_conj = quadConj(qr);
+    glm::vec4 q_pos = glm::vec4(position, 0.0f);
+
+    glm::vec4 q_tmp = quat_mult(qr, q_pos);
+    qr = quat_mult(q_tmp, qr_conj);
+
+    return glm::vec3(qr.x, qr.y, qr.z);
+}
+
+// 从笛卡尔坐标转换为球面坐标（rho, theta, phi）
+static glm::vec3 toSpherical(glm::vec3 p) {
+    float rho = std::sqrt((p.x * p.x) + (p.y * p.y) + (p.z * p.z));
+    float theta = std::atan2(p.z, p.x);
+    float phi = std::asin(p.y / rho);
+    return glm::vec3(rho, theta, phi);
+}
+
+// 构建视图矩阵
+static glm::mat3 lookAt(glm::vec3 origin, glm::vec3 target, float roll) {
+    glm::vec3 rr = glm::vec3(std::sin(roll), std::cos(roll), 0.0f);
+    glm::vec3 ww = glm::normalize(target - origin);
+    glm::vec3 uu = glm::normalize(glm::cross(ww, rr));
+    glm::vec3 vv = glm::normalize(glm::cross(uu, ww));
+
+    return glm::mat3(uu, vv, ww);
+}
+
+// 计算并设置吸积盘的颜色
+void adiskColor(const TracerUniforms& u, glm::vec3 pos, glm::vec3& color,
+    float& alpha) {
+    float innerRadius = 2.6f;
+    float outerRadius = 12.0f;
+
+    // 密度随距离增加线性减少
+    float density = glm::max(0.0f, 1.0f - glm::length(pos / glm::vec3(outerRadius,
+        u.adiskHeight, outerRadius)));
+    if (density < 0.001f) {
+        return;
+    }
+
+    density *= std::pow(1.0f - std::abs(pos.y) / u.adiskHeight, u.adiskDensityV);
+
+    // 当半径小于内稳定轨道时，密度设为0
+    density *= glm::smoothstep(innerRadius, innerRadius * 1.1f, glm::length(pos));
+
+    if (density < 0.001f) {
+        return;
+    }
+
+    glm::vec3 sphericalCoord = toSpherical(pos);
+
+    // 缩放rho和phi，使颗粒在视觉上具有正确的比例
+    sphericalCoord.y *= 2.0f;
+    sphericalCoord.z *= 4.0f;
+
+    density *= 1.0f / std::pow(sphericalCoord.x, u.adiskDensityH);
+    density *= 16000.0f;
+
+    if (u.adiskParticle < 0.5f) {
+        color += glm::vec3(0.0f, 1.0f, 0.0f) * density * 0.02f;
+        return;
+    }
+
+    float noise = 1.0f;
+    for (int i = 0; i < int(u.adiskNoiseLOD); i++) {
+        noise *= 0.5f * snoise(sphericalCoord * float(i * i) * u.adiskNoiseScale) + 0.5f;
+        if (i % 2 == 0) {
+            sphericalCoord.y += u.time * u.adiskSpeed;
+        }
+        else {
+            sphericalCoord.y -= u.time * u.adiskSpeed;
+        }
+    }
+
+    glm::vec3 dustColor = u.colorMap
+        ? sampleTexture2D(*u.colorMap, glm::vec2(sphericalCoord.x / outerRadius, 0.5f))
+        : glm::vec3(0.0f);
+
+    color += density * u.adiskLit * dustColor * alpha * std::abs(noise);
+}
+
+bool inDiskBounds(const TracerUniforms& u, glm::vec3 pos) {
+    return std::abs(pos.y) < u.adiskHeight &&
+        pos.x * pos.x + pos.z * pos.z < ADISK_OUTER_RADIUS * ADISK_OUTER_RADIUS;
+}
+
+void countDiskSamples(const TracerUniforms& u, uint64_t evaluated, uint64_t skipped) {
+    if (u.diskCounters) {
+        u.diskCounters->evaluated.fetch_add(evaluated, std::memory_order_relaxed);
+        u.diskCounters->skipped.fetch_add(skipped, std::memory_order_relaxed);
+    }
+}
+
+// 采样随时间旋转的天空盒
+glm::vec3 skyColor(const TracerUniforms& u, glm::vec3 dir) {
+    if (!u.galaxy) {
+        return glm::vec3(0.0f);
+    }
+    dir = rotateVector(dir, glm::vec3(0.0f, 1.0f, 0.0f), u.time);
+    return sampleCubemap(*u.galaxy, dir);
+}
+
+void cameraRay(const TracerUniforms& u, glm::vec2 fragCoord, glm::vec3& pos,
+    glm::vec3& dir) {
+    glm::vec3 cameraPos;
+    if (u.mouseControl > 0.5f) {
+        glm::vec2 mouse = glm::clamp(glm::vec2(u.mouseX, u.mouseY) / u.resolution,
+            0.0f, 1.0f) - 0.5f;
+        cameraPos = glm::vec3(-std::cos(mouse.x * 10.0f) * 15.0f, mouse.y * 30.0f,
+            std::sin(mouse.x * 10.0f) * 15.0f);
+    }
+    else if (u.frontView > 0.5f) {
+        cameraPos = glm::vec3(10.0f, 1.0f, 10.0f);
+    }
+    else if (u.topView > 0.5f) {
+        cameraPos = glm::vec3(15.0f, 15.0f, 0.0f);
+    }
+    else {
+        cameraPos = glm::vec3(-std::cos(u.time * 0.1f) * 15.0f,
+            std::sin(u.time * 0.1f) * 15.0f, std::sin(u.time * 0.1f) * 15.0f);
+    }
+
+    glm::vec3 target = glm::vec3(0.0f);
+    glm::mat3 view = lookAt(cameraPos, target, glm::radians(u.cameraRoll));
+
+    glm::vec2 uv = fragCoord / u.resolution - glm::vec2(0.5f);
+    uv.x *= u.resolution.x / u.resolution.y;
+
+    dir = view * glm::normalize(glm::vec3(-uv.x * u.fovScale, uv.y * u.fovScale, 1.0f));
+    pos = cameraPos;
+}
+
+// 逃逸半径，开启吸积盘时不小于盘的外半径
+float escapeRadius(const TracerUniforms& u) {
+    return u.adiskEnabled > 0.5f ? std::max(u.escapeRadius, ADISK_OUTER_RADIUS)
+        : u.escapeRadius;
+}
+
+// 位于逃逸半径外且径向速度向外的光线不会再落入视界或穿过吸积盘
+bool isEscaping(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    float radius = escapeRadius(u);
+    return u.earlyEscape > 0.5f && glm::dot(pos, pos) > radius * radius &&
+        glm::dot(pos, dir) > 0.0f;
+}
+
+// 弱场近似下从当前位置到无穷远处剩余的偏折：delta = (1 - mu)^2 * (2 + mu) / (2 * b)
+glm::vec3 asymptoticDirection(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    dir = glm::normalize(dir);
+    glm::vec3 perp = pos - glm::dot(pos, dir) * dir; // 长度为碰撞参数b
+    float b = glm::length(perp);
+    if (u.gravatationalLensing < 0.5f || b < 0.0001f) {
+        return dir;
+    }
+    float mu = glm::dot(pos, dir) / glm::length(pos);
+    float delta = (1.0f - mu) * (1.0f - mu) * (2.0f + mu) / (2.0f * b);
+    return dir * std::cos(delta) - perp * (std::sin(delta) / b);
+}
+
+// 光子球外碰撞参数小于临界值且向内运动的光线没有近心点，必然落入视界
+bool isCaptured(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    if (u.impactClassify < 0.5f || u.renderBlackHole < 0.5f ||
+        u.gravatationalLensing < 0.5f) {
+        return false;
+    }
+    float r2 = glm::dot(pos, pos);
+    float b2 = glm::dot(glm::cross(pos, dir), glm::cross(pos, dir)) / glm::dot(dir, dir);
+    return r2 > PHOTON_SPHERE_RADIUS * PHOTON_SPHERE_RADIUS && glm::dot(pos, dir) < 0.0f &&
+        b2 < CRITICAL_IMPACT_PARAMETER * CRITICAL_IMPACT_PARAMETER;
+}
+
+// 查表得到的方位角区间在插值时的误差上界
+const float LUT_PHI_MARGIN = 0.05f;
+
+// 光线在轨道平面内方位角 [phiEnter, phiExit] 之间位于吸积盘外半径以内，e1指向
+// 摄像机，e2为切向。方位角phi处径向单位向量的y分量为 e1.y * cos(phi) + e2.y * sin(phi)，
+// 区间内没有零点时光线在盘半径以内不穿过赤道面，且 |y| 不小于近心点乘以该分量
+// 在两端的较小值。返回false时光线一定不会进入吸积盘所在的平板
+static bool crossesDiskSlab(const TracerUniforms& u, glm::vec3 e1, glm::vec3 e2,
+    float phiEnter, float phiExit, float periapsis) {
+    const float pi = 3.14159265f;
+    phiEnter = std::max(phiEnter - LUT_PHI_MARGIN, 0.0f);
+    phiExit += LUT_PHI_MARGIN;
+    float zero = std::atan2(e2.y, e1.y) + 0.5f * pi - phiEnter;
+    zero = phiEnter + zero - pi * std::floor(zero / pi); // 区间起点之后的第一个零点
+    if (zero <= phiExit) {
+        return true;
+    }
+    float yEnter = e1.y * std::cos(phiEnter) + e2.y * std::sin(phiEnter);
+    float yExit = e1.y * std::cos(phiExit) + e2.y * std::sin(phiExit);
+    return periapsis * std::min(std::abs(yEnter), std::abs(yExit)) <= u.adiskHeight;
+}
+
+// 查表得到背景光线的最终方向。近心点靠近光子球的光线插值误差大，
+// 开启吸积盘时在盘半径以内可能进入盘所在平板的光线还需要逐步采样，这两类返回false
+bool traceColorLUT(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir,
+    glm::vec3& color) {
+    if (u.lensingLUT < 0.5f || !u.deflectionLUT || u.renderBlackHole < 0.5f ||
+        u.gravatationalLensing < 0.5f) {
+        return false;
+    }
+
+    float r0 = glm::length(pos);
+    float alpha = std::acos(glm::clamp(-glm::dot(pos, dir) / r0, -1.0f, 1.0f));
+    glm::vec4 deflection;
+    if (!sampleDeflectionLUT(*u.deflectionLUT, r0, alpha, deflection)) {
+        return false;
+    }
+    if (deflection.y < LUT_MIN_PERIAPSIS) {
+        return false;
+    }
+    if (u.adiskEnabled > 0.5f && deflection.y < ADISK_OUTER_RADIUS) {
+        glm::vec3 e1 = pos / r0;
+        glm::vec3 tangent = dir - glm::dot(dir, e1) * e1;
+        float sinAlpha = glm::length(tangent);
+        if (sinAlpha < 0.0001f ||
+            crossesDiskSlab(u, e1, tangent / sinAlpha, deflection.z, deflection.w,
+                deflection.y)) {
+            return false;
+        }
+    }
+
+    // 在轨道平面内朝中心方向旋转偏折角
+    glm::vec3 perp = pos - glm::dot(pos, dir) * dir;
+    float b = glm::length(perp);
+    if (b > 0.0001f) {
+        dir = dir * std::cos(deflection.x) - perp * (std::sin(deflection.x) / b);
+    }
+    color = skyColor(u, dir);
+    return true;
+}
+
+// 光线追踪计算颜色
+glm::vec3 traceColor(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    glm::vec3 color = glm::vec3(0.0f);
+    float alpha = 1.0f;
+
+    dir *= STEP_SIZE;
+
+    glm::vec3 h = glm::cross(pos, dir); // 角动量
+    float h2 = glm::dot(h, h);
+
+    for (int i = 0; i < 300; i++) {
+        if (u.renderBlackHole > 0.5f) {
+            if (u.gravatationalLensing > 0.5f) {
+                dir += accel(h2, pos);
+            }
+
+            // 到达事件视界
+            if (glm::dot(pos, pos) < 1.0f) {
+                return color;
+            }
+
+            // 已逃逸的光线直接采样天空盒
+            if (isEscaping(u, pos, dir)) {
+                if (u.escapeCorrection > 0.5f) {
+                    dir = asymptoticDirection(u, pos, dir);
+                }
+                break;
+            }
+
+            if (u.adiskEnabled > 0.5f) {
+                if (inDiskBounds(u, pos)) {
+                    adiskColor(u, pos, color, alpha);
+                    countDiskSamples(u, 1, 0);
+                }
+                else {
+                    countDiskSamples(u, 0, 1);
+                }
+            }
+        }
+
+        pos += dir;
+    }
+
+    color += skyColor(u, dir) * alpha; // 叠加天空盒颜色
+    return color;
+}
+
+// 根据半径、局部曲率和到吸积盘的距离选择步长
+static float adaptiveStepSize(const TracerUniforms& u, glm::vec3 pos, float r2,
+    float h2) {
+    float r = std::sqrt(r2);
+    float dt = STEP_SIZE * r; // 步长随半径线性放大
+
+    // 以 0.5 * |a| * dt^2 估计每步的位置误差
+    if (u.gravatationalLensing > 0.5f) {
+        float accMag = 1.5f * h2 / (r2 * r2);
+        dt = std::min(dt, std::sqrt(2.0f * u.stepTolerance / std::max(accMag, 1e-8f)));
+    }
+
+    // 吸积盘外不会跨过盘的包围圆柱，盘内保持固定步长
+    if (u.adiskEnabled > 0.5f) {
+        float diskDist = std::max(std::abs(pos.y) - u.adiskHeight,
+            std::sqrt(pos.x * pos.x + pos.z * pos.z) - ADISK_OUTER_RADIUS);
+        dt = std::min(dt, std::max(diskDist, STEP_SIZE));
+    }
+
+    return std::max(dt, STEP_SIZE * 0.1f);
+}
+
+// 自适应步长的光线追踪，dir为单位方向，用蛙跳法（速度Verlet）积分
+glm::vec3 traceColorAdaptive(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    glm::vec3 color = glm::vec3(0.0f);
+    float alpha = 1.0f;
+
+    glm::vec3 h = glm::cross(pos, dir);
+    float h2 = glm::dot(h, h);
+
+    float pathLength = 0.0f;
+    glm::vec3 acc = accel(h2, pos);
+    for (int i = 0; i < int(u.maxSteps) && pathLength < MAX_PATH_LENGTH; i++) {
+        if (u.renderBlackHole > 0.5f) {
+            float r2 = glm::dot(pos, pos);
+            if (r2 < 1.0f) { // 到达事件视界
+                return color;
+            }
+            if (isEscaping(u, pos, dir)) {
+                if (u.escapeCorrection > 0.5f) {
+                    dir = asymptoticDirection(u, pos, dir);
+                }
+                break;
+            }
+
+            float dt = std::min(adaptiveStepSize(u, pos, r2, h2),
+                MAX_PATH_LENGTH - pathLength); // 不越过与固定步长相同的终点
+            if (u.adiskEnabled > 0.5f) {
+                if (inDiskBounds(u, pos)) {
+                    // 盘内的体积采样按步长加权，与固定步长的累加结果一致
+                    glm::vec3 diskColor = glm::vec3(0.0f);
+                    adiskColor(u, pos, diskColor, alpha);
+                    color += diskColor * (dt / STEP_SIZE);
+                    countDiskSamples(u, 1, 0);
+                }
+                else {
+                    countDiskSamples(u, 0, 1);
+                }
+            }
+
+            if (u.gravatationalLensing > 0.5f) {
+                dir += acc * (0.5f * dt);
+                pos += dir * dt;
+                acc = accel(h2, pos); // 每步只计算一次加速度
+                dir += acc * (0.5f * dt);
+            }
+            else {
+                pos += dir * dt;
+            }
+            pathLength += dt;
+        }
+        else {
+            pos += dir * (MAX_PATH_LENGTH - pathLength); // 直线传播
+            pathLength = MAX_PATH_LENGTH;
+        }
+    }
+
+    color += skyColor(u, dir) * alpha;
+    return color;
+}
+
+// 必然落入视界的光线只累加吸积盘的颜色。r单调减小，离开吸积盘所在区域
+// （|y| < adiskHeight 且 r < 12）或进入内半径后不再有贡献
+glm::vec3 traceColorCaptured(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    glm::vec3 color = glm::vec3(0.0f);
+    float alpha = 1.0f;
+    if (u.adiskEnabled < 0.5f) {
+        return color;
+    }
+
+    glm::vec3 h = glm::cross(pos, dir);
+    float h2 = glm::dot(h, h);
+
+    bool crossed = false;
+    glm::vec3 acc = accel(h2, pos);
+    for (int i = 0; i < int(u.maxSteps); i++) {
+        float r2 = glm::dot(pos, pos);
+        if (r2 < ADISK_INNER_RADIUS * ADISK_INNER_RADIUS) {
+            break;
+        }
+        bool inside = inDiskBounds(u, pos);
+        if (crossed && !inside) {
+            break;
+        }
+        crossed = crossed || inside;
+
+        float dt = adaptiveStepSize(u, pos, r2, h2);
+        if (inside) {
+            glm::vec3 diskColor = glm::vec3(0.0f);
+            adiskColor(u, pos, diskColor, alpha);
+            color += diskColor * (dt / STEP_SIZE);
+            countDiskSamples(u, 1, 0);
+        }
+        else {
+            countDiskSamples(u, 0, 1);
+        }
+
+        dir += acc * (0.5f * dt);
+        pos += dir * dt;
+        acc = accel(h2, pos);
+        dir += acc * (0.5f * dt);
+    }
+    return color;
+}
+
+// 比奈方程 u'' = -u + k * u^2 （u = 1 / r，对方位角求导）的四阶龙格-库塔单步，
+// 开启引力透镜时k = 1.5，否则为直线
+static void binetStep(float k, float dphi, float& x, float& dx) {
+    auto f = [k](float v) { return -v + k * v * v; };
+    float k1x = dx, k1v = f(x);
+    float k2x = dx + 0.5f * dphi * k1v, k2v = f(x + 0.5f * dphi * k1x);
+    float k3x = dx + 0.5f * dphi * k2v, k3v = f(x + 0.5f * dphi * k2x);
+    float k4x = dx + dphi * k3v, k4v = f(x + dphi * k3x);
+    x += dphi / 6.0f * (k1x + 2.0f * k2x + 2.0f * k3x + k4x);
+    dx += dphi / 6.0f * (k1v + 2.0f * k2v + 2.0f * k3v + k4v);
+}
+
+// 由一步两端的u和du/dphi做三次Hermite插值，t取[0, 1]
+static float hermite(float x0, float dx0, float x1, float dx1, float dphi, float t) {
+    float t2 = t * t, t3 = t2 * t;
+    return (2.0f * t3 - 3.0f * t2 + 1.0f) * x0 + (t3 - 2.0f * t2 + t) * dphi * dx0 +
+        (-2.0f * t3 + 3.0f * t2) * x1 + (t3 - t2) * dphi * dx1;
+}
+
+// 在光线的轨道平面内积分。e1指向初始位置，e2为与之垂直的切向，
+// 平面内方位角phi处的点为 (cos(phi) * e1 + sin(phi) * e2) / u。
+// 吸积盘所在区域 |y| < adiskHeight 且 r < 12 的入口由求根得到，区域内按固定弧长采样
+glm::vec3 traceColorPlanar(const TracerUniforms& u, glm::vec3 pos, glm::vec3 dir) {
+    float r0 = glm::length(pos);
+    glm::vec3 e1 = pos / r0;
+    glm::vec3 tangent = dir - glm::dot(dir, e1) * e1;
+    float sinAlpha = glm::length(tangent);
+    if (u.renderBlackHole < 0.5f || sinAlpha < 0.0001f) {
+        return traceColorAdaptive(u, pos, dir); // 径向光线的轨道平面不确定
+    }
+    glm::vec3 e2 = tangent / sinAlpha;
+
+    glm::vec3 color = glm::vec3(0.0f);
+    float alpha = 1.0f;
+
+    const float k = u.gravatationalLensing > 0.5f ? 1.5f : 0.0f;
+    const bool adisk = u.adiskEnabled > 0.5f;
+
+    // 到吸积盘所在区域的距离下界，在区域内时不大于0
+    auto diskDistance = [&](float phi, float x) {
+        float y = (e1.y * std::cos(phi) + e2.y * std::sin(phi)) / x;
+        return std::max(std::abs(y) - u.adiskHeight, 1.0f / x - ADISK_OUTER_RADIUS);
+    };
+
+    // 方位角phi处的位置和单位切向
+    auto position = [&](float phi, float x) {
+        return (e1 * std::cos(phi) + e2 * std::sin(phi)) / x;
+    };
+    auto direction = [&](float phi, float x, float dx) {
+        glm::vec3 radial = e1 * std::cos(phi) + e2 * std::sin(phi);
+        glm::vec3 normal = e2 * std::cos(phi) - e1 * std::sin(phi);
+        return glm::normalize(normal * x - radial * dx);
+    };
+
+    const float escapeU = 1.0f / escapeRadius(u);
+    float x = 1.0f / r0;
+    float dx = -x * glm::dot(dir, e1) / sinAlpha; // du/dphi，入射时为正
+    float phi = 0.0f;
+    bool inside = false;
+    for (int i = 0; i < int(u.maxSteps); i++) {
+        // 与isEscaping()相同：位于逃逸半径外且向外运动（du/dphi < 0）
+        if (u.earlyEscape > 0.5f && x < escapeU && dx < 0.0f) {
+            pos = position(phi, x);
+            dir = direction(phi, x, dx);
+            if (u.escapeCorrection > 0.5f) {
+                dir = asymptoticDirection(u, pos, dir);
+            }
+            return color + skyColor(u, dir) * alpha;
+        }
+
+        // 弧长 ds = dphi / u * sqrt(1 + (u' / u)^2)
+        float phiPerLength = x / std::sqrt(1.0f + (dx / x) * (dx / x));
+        float dphi = PLANAR_MAX_DPHI;
+        if (inside) {
+            adiskColor(u, position(phi, x), color, alpha);
+            countDiskSamples(u, 1, 0);
+            dphi = STEP_SIZE * phiPerLength;
+        }
+        else if (adisk) {
+            dphi = std::min(dphi,
+                std::max(diskDistance(phi, x), STEP_SIZE) * phiPerLength);
+            countDiskSamples(u, 0, 1);
+        }
+
+        float x0 = x, dx0 = dx;
+        binetStep(k, dphi, x, dx);
+        if (x >= 1.0f) { // 到达事件视界
+            return color;
+        }
+        if (x <= 0.0f) {
+            // 在u = 0处插值出逃逸方位角，该处的径向即为最终方向
+            phi += dphi * x0 / (x0 - x);
+            dir = e1 * std::cos(phi) + e2 * std::sin(phi);
+            return color + skyColor(u, dir) * alpha;
+        }
+
+        if (adisk) {
+            bool entering = !inside && diskDistance(phi + dphi, x) <= 0.0f;
+            if (entering) {
+                // 二分求出进入区域的方位角，退回到该处
+                float lo = 0.0f, hi = dphi;
+                for (int j = 0; j < 8; j++) {
+                    float mid = 0.5f * (lo + hi);
+                    float xm = hermite(x0, dx0, x, dx, dphi, mid / dphi);
+                    if (diskDistance(phi + mid, xm) <= 0.0f) {
+                        hi = mid;
+                    }
+                    else {
+                        lo = mid;
+                    }
+                }
+                x = x0;
+                dx = dx0;
+                dphi = hi;
+                binetStep(k, dphi, x, dx);
+            }
+            inside = entering || (inside && diskDistance(phi + dphi, x) <= 0.0f);
+        }
+        phi += dphi;
+    }
+
+    // 步数用尽时按当前切向采样天空盒
+    return color + skyColor(u, direction(phi, x, dx)) * alpha;
+}
+
+// 将画面分块交给各线程。块内逐像素生成光线，能查表的直接写出，
+// 其余的依次装入光线包，装满后由光线包内核追踪并写入RGB浮点缓冲
+void renderToBuffer(const RenderToBufferInfo& rtbi) {
+    TracerUniforms u = resolveTracerUniforms(rtbi);
+    const RayPacketKernel& kernel =
+        rtbi.kernel ? *rtbi.kernel : selectPacketKernel();
+
+    TileSchedulerInfo schedulerInfo;
+    schedulerInfo.tileSize = rtbi.tileSize;
+    schedulerInfo.threadCount = rtbi.threadCount;
+
+    runTileScheduler(rtbi.width, rtbi.height, schedulerInfo, [&](const Tile& tile) {
+        RayPacket packet;
+        float* outputs[RAY_PACKET_MAX]; // 包内每条光线对应的输出位置
+        packet.count = 0;
+
+        auto flush = [&]() {
+            kernel.trace(u, packet);
+            for (int i = 0; i < packet.count; i++) {
+                outputs[i][0] = packet.r[i];
+                outputs[i][1] = packet.g[i];
+                outputs[i][2] = packet.b[i];
+            }
+            packet.count = 0;
+        };
+
+        for (int y = tile.y; y < tile.y + tile.height; y++) {
+            for (int x = tile.x; x < tile.x + tile.width; x++) {
+                glm::vec3 pos, dir, color;
+                cameraRay(u, glm::vec2(x + 0.5f, y + 0.5f), pos, dir); // 与gl_FragCoord一致
+                float* out = rtbi.targetBuffer + (size_t(y) * rtbi.width + x) * 3;
+                if (isCaptured(u, pos, dir)) { // 阴影区的光线只需追踪到吸积盘
+                    color = traceColorCaptured(u, pos, dir);
+                    out[0] = color.r;
+                    out[1] = color.g;
+                    out[2] = color.b;
+                    continue;
+                }
+                if (traceColorLUT(u, pos, dir, color)) {
+                    out[0] = color.r;
+                    out[1] = color.g;
+                    out[2] = color.b;
+                    continue;
+                }
+
+                int i = packet.count++;
+                packet.px[i] = pos.x;
+                packet.py[i] = pos.y;
+                packet.pz[i] = pos.z;
+                packet.dx[i] = dir.x;
+                packet.dy[i] = dir.y;
+                packet.dz[i] = dir.z;
+                outputs[i] = out;
+                if (packet.count == kernel.width) {
+                    flush();
+                }
+            }
+        }
+        if (packet.count > 0) {
+            flush();
+        }
+    }, rtbi.stats);
+}
@@ -0,0 +1,140 @@
+#ifndef CPU_TRACER_H
+#define CPU_TRACER_H
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <glm/glm.hpp>
+
+#include "cpu_texture.h"
+#include "deflection_lut.h"
+
+struct RayPacketKernel;
+struct TileRenderStats;
+
+// 调试用的吸积盘采样计数：evaluated 为实际调用 adiskColor() 的次数，
+// skipped 为被包围体测试跳过的次数
+struct DiskSampleCounters {
+  std::atomic<uint64_t> evaluated{0};
+  std::atomic<uint64_t> skipped{0};
+};
+
+// blackhole_main.frag 中 uniform 的 CPU 副本，默认值与着色器声明一致
+struct TracerUniforms {
+  glm::vec2 resolution = glm::vec2(1920.0f, 1080.0f);
+  float mouseX = 0.0f;
+  float mouseY = 0.0f;
+  float time = 0.0f;
+
+  float frontView = 0.0f;
+  float topView = 0.0f;
+  float cameraRoll = 0.0f;
+
+  float gravatationalLensing = 1.0f;
+  float renderBlackHole = 1.0f;
+  float mouseControl = 0.0f;
+  float fovScale = 1.0f;
+
+  float adiskEnabled = 1.0f;
+  float adiskParticle = 1.0f;
+  float adiskHeight = 0.2f;
+  float adiskLit = 0.5f;
+  float adiskDensityV = 1.0f;
+  float adiskDensityH = 1.0f;
+  float adiskNoiseScale = 1.0f;
+  float adiskNoiseLOD = 5.0f;
+  float adiskSpeed = 0.5f;
+
+  float adaptiveStep = 1.0f;
+  float stepTolerance = 0.003f;
+  float maxSteps = 300.0f;
+
+  float earlyEscape = 1.0f;
+  float escapeCorrection = 1.0f;
+  float escapeRadius = 12.0f;
+
+  float lensingLUT = 1.0f;
+  float planarOrbit = 1.0f;
+  float impactClassify = 1.0f;
+
+  const CpuCubemap *galaxy = nullptr;
+  const CpuTexture2D *colorMap = nullptr;
+  const DeflectionLUT *deflectionLUT = nullptr;
+  DiskSampleCounters *diskCounters = nullptr; // 非空时统计吸积盘采样
+};
+
+// 与 RenderToTextureInfo 对应，floatUniforms 可直接复用 ImGui 控件填好的表
+struct RenderToBufferInfo {
+  std::map<std::string, float> floatUniforms;
+  std::map<std::string, const CpuTexture2D *> textureUniforms;
+  std::map<std::string, const CpuCubemap *> cubemapUniforms;
+  const DeflectionLUT *deflectionLUT = nullptr; // 对应着色器中的 deflectionLUT
+  float time = 0.0f;
+  float *targetBuffer = nullptr; // width * height * 3，行序自下而上，与 glReadPixels 一致
+  const RayPacketKernel *kernel = nullptr; // 为空时按 CPU 指令集自动选择
+  int threadCount = 0;                     // 0 表示使用全部硬件线程
+  int tileSize = 32;
+  TileRenderStats *stats = nullptr;        // 非空时输出每块的耗时
+  DiskSampleCounters *diskCounters = nullptr; // 非空时统计吸积盘采样次数
+  int width;
+  int height;
+};
+
+// 按名字设置 uniform，着色器中不存在的名字返回 false
+bool setTracerUniform(TracerUniforms &uniforms, const std::string &name,
+                      float value);
+
+TracerUniforms resolveTracerUniforms(const RenderToBufferInfo &rtbi);
+
+float snoise(glm::vec3 v);
+
+void adiskColor(const TracerUniforms &u, glm::vec3 pos, glm::vec3 &color,
+                float &alpha);
+
+// 吸积盘的保守包围体：|y| < adiskHeight 的平板与外半径圆柱的交集，
+// 包围体外 adiskColor() 的密度必为 0
+bool inDiskBounds(const TracerUniforms &u, glm::vec3 pos);
+
+// 开启 diskCounters 时累加采样次数
+void countDiskSamples(const TracerUniforms &u, uint64_t evaluated,
+                      uint64_t skipped);
+
+glm::vec3 skyColor(const TracerUniforms &u, glm::vec3 dir);
+
+// 对应着色器 main() 中的摄像机部分，fragCoord 为像素中心坐标
+void cameraRay(const TracerUniforms &u, glm::vec2 fragCoord, glm::vec3 &pos,
+               glm::vec3 &dir);
+
+float escapeRadius(const TracerUniforms &u);
+
+bool isEscaping(const TracerUniforms &u, glm::vec3 pos, glm::vec3 dir);
+
+// 补上光线从 pos 到无穷远处剩余的偏折，返回单位方向
+glm::vec3 asymptoticDirection(const TracerUniforms &u, glm::vec3 pos,
+                              glm::vec3 dir);
+
+// 碰撞参数小于临界值 3 * sqrt(3) * M 且向内运动的光线必然落入视界
+bool isCaptured(const TracerUniforms &u, glm::vec3 pos, glm::vec3 dir);
+
+// 只追踪 isCaptured() 的光线穿过吸积盘的一段，关闭吸积盘时直接返回黑色
+glm::vec3 traceColorCaptured(const TracerUniforms &u, glm::vec3 pos,
+                             glm::vec3 dir);
+
+// 用偏折角查找表直接得到背景光线的颜色，需要逐步积分时返回 false
+bool traceColorLUT(const TracerUniforms &u, glm::vec3 pos, glm::vec3 dir,
+                   glm::vec3 &color);
+
+glm::vec3 traceColor(const TracerUniforms &u, glm::vec3 pos, glm::vec3 dir);
+
+glm::vec3 traceColorAdaptive(const TracerUniforms &u, glm::vec3 pos,
+                             glm::vec3 dir);
+
+// 在轨道平面内对 u = 1 / r 求解比奈方程，dir 为单位方向
+glm::vec3 traceColorPlanar(const TracerUniforms &u, glm::vec3 pos,
+                           glm::vec3 dir);
+
+void renderToBuffer(const RenderToBufferInfo &rtbi);
+
+#endif /* CPU_TRACER_H */
@@ -0,0 +1,203 @@
+#include "deflection_lut.h" // 偏折角查找表头文件
+
+#include <algorithm> // std::min
+#include <atomic> // 原子计数
+#include <cmath> // 数学函数
+#include <cstdio> // 文件读写
+#include <cstring> // memcmp
+#include <filesystem> // 创建缓存目录
+#include <iostream> // 输入输出流
+#include <thread> // 工作线程
+
+const double PI = 3.14159265358979323846;
+const double PHI_STEP = 0.005; // 方位角步长，RK4在此步长下的误差远小于一个像素
+const double MAX_PHI = 8.0 * PI; // 绕行超过四圈的光线紧贴光子球，不再积分
+
+const char LUT_MAGIC[4] = { 'B', 'H', 'D', 'L' };
+const int LUT_VERSION = 2;
+
+// 从半径r0处出发、与指向中心方向夹角为alpha的光线，返回(偏折角, 近心点半径,
+// 进入和离开 diskRadius 的方位角)
+static glm::vec4 integrateDeflection(double r0, double alpha, double diskRadius) {
+    double s = std::sin(alpha);
+    if (s < 1e-6) {
+        // 沿径向入射的光线落入视界，沿径向出射的光线不偏折
+        return alpha < 0.5 * PI ? glm::vec4(0.0f) : glm::vec4(0.0f, (float)r0, 0.0f, 0.0f);
+    }
+
+    double u = 1.0 / r0;
+    double du = u * std::cos(alpha) / s; // du/dphi，入射时为正
+    double uMax = u;
+    const double uDisk = 1.0 / diskRadius;
+    double periapsisPhi = 0.0; // 出射光线的近心点即为摄像机
+    double enterPhi = u > uDisk ? 0.0 : -1.0;
+    double exitPhi = -1.0;
+    // 近心点在盘半径之外时区间退化为近心点
+    auto result = [&](float deflection, float periapsis) {
+        if (enterPhi < 0.0) {
+            return glm::vec4(deflection, periapsis, (float)periapsisPhi, (float)periapsisPhi);
+        }
+        return glm::vec4(deflection, periapsis, (float)enterPhi,
+            (float)(exitPhi < 0.0 ? MAX_PHI : exitPhi));
+    };
+
+    auto f = [](double x) { return -x + 1.5 * x * x; };
+    for (double phi = 0.0; phi < MAX_PHI; phi += PHI_STEP) {
+        // 经典四阶龙格-库塔
+        double k1u = du, k1v = f(u);
+        double k2u = du + 0.5 * PHI_STEP * k1v, k2v = f(u + 0.5 * PHI_STEP * k1u);
+        double k3u = du + 0.5 * PHI_STEP * k2v, k3v = f(u + 0.5 * PHI_STEP * k2u);
+        double k4u = du + PHI_STEP * k3v, k4v = f(u + PHI_STEP * k3u);
+        double uNext = u + PHI_STEP / 6.0 * (k1u + 2.0 * k2u + 2.0 * k3u + k4u);
+        double duNext = du + PHI_STEP / 6.0 * (k1v + 2.0 * k2v + 2.0 * k3v + k4v);
+
+        if (uNext >= 1.0) { // 到达事件视界
+            return glm::vec4(0.0f);
+        }
+        // 各事件的方位角都在步内线性插值
+        if (du > 0.0 && duNext <= 0.0) {
+            periapsisPhi = phi + PHI_STEP * du / (du - duNext);
+        }
+        if (u <= uDisk && uNext > uDisk) {
+            enterPhi = phi + PHI_STEP * (uDisk - u) / (uNext - u);
+        }
+        if (u > uDisk && uNext <= uDisk) {
+            exitPhi = phi + PHI_STEP * (u - uDisk) / (u - uNext);
+        }
+        if (uNext <= 0.0) {
+            // 在u = 0处线性插值出总方位角，减去直线传播扫过的 PI - alpha
+            double phiEnd = phi + PHI_STEP * u / (u - uNext);
+            return result((float)(phiEnd - (PI - alpha)), (float)(1.0 / uMax));
+        }
+
+        u = uNext;
+        du = duNext;
+        uMax = std::max(uMax, u);
+    }
+    return result(0.0f, (float)(1.0 / uMax));
+}
+
+DeflectionLUT computeDeflectionLUT(const DeflectionLUTInfo& info) {
+    DeflectionLUT lut;
+    lut.info = info;
+    lut.texels.resize(size_t(info.angleCount) * info.radiusCount * 4);
+
+    // 各行互不相关，按行分给所有硬件线程
+    std::atomic<int> nextRow(0);
+    auto worker = [&]() {
+        for (int row = nextRow++; row < info.radiusCount; row = nextRow++) {
+            double r0 = info.minRadius + (info.maxRadius - info.minRadius) * row /
+                std::max(info.radiusCount - 1, 1);
+            for (int i = 0; i < info.angleCount; i++) {
+                double alpha = PI * i / std::max(info.angleCount - 1, 1);
+                glm::vec4 texel = integrateDeflection(r0, alpha, info.diskRadius);
+                size_t index = (size_t(row) * info.angleCount + i) * 4;
+                for (int c = 0; c < 4; c++) {
+                    lut.texels[index + c] = texel[c];
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    int threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    return lut;
+}
+
+std::string deflectionLUTCacheFile(const DeflectionLUTInfo& info,
+    const std::string& cacheDir) {
+    char name[128];
+    snprintf(name, sizeof(name), "deflection_r%g-%g_d%g_%dx%d.bin", info.minRadius,
+        info.maxRadius, info.diskRadius, info.angleCount, info.radiusCount);
+    return cacheDir + "/" + name;
+}
+
+bool loadDeflectionLUT(const std::string& file, const DeflectionLUTInfo& info,
+    DeflectionLUT& lut) {
+    FILE* fp = fopen(file.c_str(), "rb");
+    if (!fp) {
+        return false;
+    }
+
+    char magic[4];
+    int version = 0;
+    DeflectionLUTInfo header;
+    bool ok = fread(magic, 1, 4, fp) == 4 && fread(&version, sizeof(int), 1, fp) == 1 &&
+        fread(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && !memcmp(magic, LUT_MAGIC, 4) && version == LUT_VERSION &&
+        header.angleCount == info.angleCount && header.radiusCount == info.radiusCount &&
+        header.minRadius == info.minRadius && header.maxRadius == info.maxRadius &&
+        header.diskRadius == info.diskRadius;
+    if (ok) {
+        lut.info = info;
+        lut.texels.resize(size_t(info.angleCount) * info.radiusCount * 4);
+        ok = fread(lut.texels.data(), sizeof(float), lut.texels.size(), fp) ==
+            lut.texels.size();
+    }
+    fclose(fp);
+    return ok;
+}
+
+bool saveDeflectionLUT(const std::string& file, const DeflectionLUT& lut) {
+    FILE* fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    fwrite(LUT_MAGIC, 1, 4, fp);
+    fwrite(&LUT_VERSION, sizeof(int), 1, fp);
+    fwrite(&lut.info, sizeof(lut.info), 1, fp);
+    fwrite(lut.texels.data(), sizeof(float), lut.texels.size(), fp);
+    fclose(fp);
+    return true;
+}
+
+DeflectionLUT loadOrComputeDeflectionLUT(const DeflectionLUTInfo& info,
+    const std::string& cacheDir) {
+    DeflectionLUT lut;
+    std::string file = deflectionLUTCacheFile(info, cacheDir);
+    if (loadDeflectionLUT(file, info, lut)) {
+        return lut;
+    }
+
+    lut = computeDeflectionLUT(info);
+    std::error_code ec;
+    std::filesystem::create_directories(cacheDir, ec);
+    if (!saveDeflectionLUT(file, lut)) {
+        std::cout << "WARNING: Failed to write deflection LUT cache: " << file
+            << std::endl;
+    }
+    return lut;
+}
+
+bool sampleDeflectionLUT(const DeflectionLUT& lut, float cameraRadius, float angle,
+    glm::vec4& deflection) {
+    const DeflectionLUTInfo& info = lut.info;
+    if (lut.texels.empty() || cameraRadius < info.minRadius ||
+        cameraRadius > info.maxRadius) {
+        return false;
+    }
+
+    // 纹素i位于 alpha = PI * i / (angleCount - 1)，与着色器中的纹理坐标换算一致
+    float x = glm::clamp(angle / (float)PI, 0.0f, 1.0f) * (info.angleCount - 1);
+    float y = (cameraRadius - info.minRadius) / (info.maxRadius - info.minRadius) *
+        (info.radiusCount - 1);
+    int x0 = std::min((int)x, info.angleCount - 2);
+    int y0 = std::min((int)y, info.radiusCount - 2);
+    float fx = x - x0, fy = y - y0;
+
+    auto texel = [&](int i, int row) {
+        size_t index = (size_t(row) * info.angleCount + i) * 4;
+        return glm::vec4(lut.texels[index], lut.texels[index + 1], lut.texels[index + 2],
+            lut.texels[index + 3]);
+    };
+    deflection = glm::mix(glm::mix(texel(x0, y0), texel(x0 + 1, y0), fx),
+        glm::mix(texel(x0, y0 + 1), texel(x0 + 1, y0 + 1), fx), fy);
+    return true;
+}
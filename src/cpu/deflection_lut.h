@@ -0,0 +1,50 @@
+#ifndef DEFLECTION_LUT_H
+#define DEFLECTION_LUT_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// 史瓦西度规（rs = 1）下光线从摄像机到无穷远处的总偏折角查找表。
+// 横轴为光线与指向中心方向的夹角 alpha，取 [0, PI]；纵轴为摄像机半径，
+// 取 [minRadius, maxRadius]，两个方向都均匀采样且包含端点
+struct DeflectionLUTInfo {
+  int angleCount = 2048;
+  int radiusCount = 64;
+  float minRadius = 4.0f;
+  float maxRadius = 40.0f;
+  float diskRadius = 12.0f; // 吸积盘外半径，用于记录光线在盘半径以内的方位角区间
+};
+
+struct DeflectionLUT {
+  DeflectionLUTInfo info;
+  // angleCount * radiusCount 个 RGBA 纹素，按行存放（每行一个摄像机半径）：
+  //   R 偏折角（在轨道平面内朝中心方向旋转的弧度）
+  //   G 近心点半径，落入视界的光线为 0
+  //   B, A 光线位于 diskRadius 以内的轨道平面方位角区间（从摄像机起算），
+  //        近心点在 diskRadius 之外时两者都取近心点的方位角
+  std::vector<float> texels;
+};
+
+// 积分比奈方程 u'' = -u + 1.5 * u^2 （u = 1 / r）填表
+DeflectionLUT computeDeflectionLUT(const DeflectionLUTInfo &info);
+
+// 缓存文件名由摄像机半径范围和表的尺寸组成，参数变化时自动重建
+std::string deflectionLUTCacheFile(const DeflectionLUTInfo &info,
+                                   const std::string &cacheDir);
+
+bool loadDeflectionLUT(const std::string &file, const DeflectionLUTInfo &info,
+                       DeflectionLUT &lut);
+
+bool saveDeflectionLUT(const std::string &file, const DeflectionLUT &lut);
+
+// 优先读取缓存，不存在或不匹配时重新计算并写回
+DeflectionLUT loadOrComputeDeflectionLUT(const DeflectionLUTInfo &info,
+                                         const std::string &cacheDir = "cache");
+
+// 与 GL_LINEAR 采样一致的双线性插值，cameraRadius 超出范围时返回 false
+bool sampleDeflectionLUT(const DeflectionLUT &lut, float cameraRadius,
+                         float angle, glm::vec4 &deflection);
+
+#endif /* DEFLECTION_LUT_H */
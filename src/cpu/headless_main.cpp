@@ -0,0 +1,276 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "cpu_packet.h" // 光线包内核
+#include "cpu_scheduler.h" // 分块调度
+#include "cpu_texture.h" // CPU纹理
+#include "cpu_tracer.h" // CPU光线追踪
+
+// 无GPU环境下的离线渲染入口，输出PFM格式的RGB浮点图像
+//
+// 用法: BlackholeHeadless [--width W] [--height H] [--time T]
+//                         [--set name=value]... [--out frame.pfm]
+//                         [--kernel scalar|sse4|avx2|avx512] [--bench]
+//                         [--threads N] [--tile S] [--scaling]
+//                         [--tile-costs costs.csv] [--tile-histogram hist.csv]
+//                         [--disk-stats]
+//
+// --bench 依次用每个可用内核渲染同一帧，输出每秒光线数及与标量结果的最大误差
+// --scaling 以1,2,4...个线程渲染同一帧，输出加速比和并行效率
+// --disk-stats 统计吸积盘包围体测试跳过的adiskColor()调用次数
+
+// 写出PFM文件，PFM的行序自下而上，与renderToBuffer()的输出一致
+static bool writePFM(const std::string& file, const float* rgb, int width,
+    int height) {
+    FILE* fp = fopen(file.c_str(), "wb");
+    if (!fp) {
+        return false;
+    }
+    fprintf(fp, "PF\n%d %d\n-1.0\n", width, height); // 负比例表示小端
+    fwrite(rgb, sizeof(float), size_t(width) * height * 3, fp);
+    fclose(fp);
+    return true;
+}
+
+// 对每个可用的光线包内核测量每秒光线数
+static void benchmarkKernels(RenderToBufferInfo rtbi) {
+    size_t pixels = size_t(rtbi.width) * rtbi.height;
+    std::vector<float> reference(pixels * 3);
+    std::vector<float> buffer(pixels * 3);
+
+    printf("%-8s %5s %14s %10s %12s\n", "kernel", "width", "rays/s", "speedup",
+        "max |diff|");
+    double scalarRate = 0.0;
+    for (const RayPacketKernel* kernel : availablePacketKernels()) {
+        rtbi.kernel = kernel;
+        rtbi.targetBuffer = kernel->level == SimdLevel::Scalar ? reference.data()
+            : buffer.data();
+
+        auto start = std::chrono::steady_clock::now();
+        renderToBuffer(rtbi);
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+        double rate = pixels / elapsed.count();
+        if (kernel->level == SimdLevel::Scalar) {
+            scalarRate = rate;
+        }
+
+        float maxDiff = 0.0f;
+        for (size_t i = 0; kernel->level != SimdLevel::Scalar && i < buffer.size(); i++) {
+            float d = buffer[i] - reference[i];
+            maxDiff = d > maxDiff ? d : (-d > maxDiff ? -d : maxDiff);
+        }
+        printf("%-8s %5d %14.0f %9.2fx %12g\n", kernel->name, kernel->width, rate,
+            rate / scalarRate, maxDiff);
+    }
+}
+
+// 以不同线程数渲染同一帧，衡量分块调度的扩展性
+static void benchmarkScaling(RenderToBufferInfo rtbi) {
+    std::vector<float> buffer(size_t(rtbi.width) * rtbi.height * 3);
+    rtbi.targetBuffer = buffer.data();
+
+    int maxThreads = (int)std::thread::hardware_concurrency();
+    std::vector<int> threadCounts;
+    for (int n = 1; n < maxThreads; n *= 2) {
+        threadCounts.push_back(n);
+    }
+    threadCounts.push_back(std::max(1, maxThreads));
+
+    printf("%7s %10s %9s %10s %7s\n", "threads", "ms", "speedup", "efficiency",
+        "steals");
+    double baseline = 0.0;
+    for (int n : threadCounts) {
+        TileRenderStats stats;
+        rtbi.threadCount = n;
+        rtbi.stats = &stats;
+        renderToBuffer(rtbi);
+
+        if (baseline == 0.0) {
+            baseline = stats.wallSeconds;
+        }
+        double speedup = baseline / stats.wallSeconds;
+        printf("%7d %10.1f %8.2fx %9.1f%% %7d\n", stats.threadCount,
+            stats.wallSeconds * 1000.0, speedup, speedup / stats.threadCount * 100.0,
+            stats.steals);
+    }
+}
+
+int main(int argc, char** argv) {
+    RenderToBufferInfo rtbi;
+    rtbi.width = 1920; // 与main.cpp中的SCR_WIDTH一致
+    rtbi.height = 1080; // 与main.cpp中的SCR_HEIGHT一致
+    std::string outFile = "frame.pfm";
+
+    // 与main.cpp中ImGui控件的默认值一致
+    rtbi.floatUniforms["renderBlackHole"] = 1.0f;
+    rtbi.floatUniforms["mouseControl"] = 1.0f;
+    rtbi.floatUniforms["cameraRoll"] = 0.0f;
+    rtbi.floatUniforms["frontView"] = 0.0f;
+    rtbi.floatUniforms["topView"] = 0.0f;
+    rtbi.floatUniforms["adiskEnabled"] = 1.0f;
+    rtbi.floatUniforms["adiskParticle"] = 1.0f;
+    rtbi.floatUniforms["adiskDensityV"] = 2.0f;
+    rtbi.floatUniforms["adiskDensityH"] = 4.0f;
+    rtbi.floatUniforms["adiskHeight"] = 0.55f;
+    rtbi.floatUniforms["adiskLit"] = 0.25f;
+    rtbi.floatUniforms["adiskNoiseLOD"] = 5.0f;
+    rtbi.floatUniforms["adiskNoiseScale"] = 0.8f;
+    rtbi.floatUniforms["adiskSpeed"] = 0.5f;
+    rtbi.floatUniforms["adaptiveStep"] = 1.0f;
+    rtbi.floatUniforms["stepTolerance"] = 0.003f;
+    rtbi.floatUniforms["maxSteps"] = 300.0f;
+    rtbi.floatUniforms["earlyEscape"] = 1.0f;
+    rtbi.floatUniforms["escapeCorrection"] = 1.0f;
+    rtbi.floatUniforms["escapeRadius"] = 12.0f;
+    rtbi.floatUniforms["lensingLUT"] = 1.0f;
+    rtbi.floatUniforms["planarOrbit"] = 1.0f;
+    rtbi.floatUniforms["impactClassify"] = 1.0f;
+
+    bool mouseSet = false;
+    bool bench = false;
+    bool scaling = false;
+    bool diskStats = false;
+    std::string tileCostFile, tileHistogramFile;
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (!strcmp(argv[i], "--width") && hasValue) {
+            rtbi.width = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--height") && hasValue) {
+            rtbi.height = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--time") && hasValue) {
+            rtbi.time = (float)atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--out") && hasValue) {
+            outFile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--kernel") && hasValue) {
+            const char* name = argv[++i];
+            for (const RayPacketKernel* kernel : availablePacketKernels()) {
+                if (!strcmp(kernel->name, name)) {
+                    rtbi.kernel = kernel;
+                }
+            }
+            if (!rtbi.kernel) {
+                fprintf(stderr, "Kernel %s is not available on this CPU\n", name);
+                return 1;
+            }
+        }
+        else if (!strcmp(argv[i], "--bench")) {
+            bench = true;
+        }
+        else if (!strcmp(argv[i], "--scaling")) {
+            scaling = true;
+        }
+        else if (!strcmp(argv[i], "--disk-stats")) {
+            diskStats = true;
+        }
+        else if (!strcmp(argv[i], "--threads") && hasValue) {
+            rtbi.threadCount = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--tile") && hasValue) {
+            rtbi.tileSize = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--tile-costs") && hasValue) {
+            tileCostFile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--tile-histogram") && hasValue) {
+            tileHistogramFile = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--set") && hasValue) {
+            // name=value，名字与RenderToTextureInfo::floatUniforms相同
+            std::string kv = argv[++i];
+            size_t eq = kv.find('=');
+            if (eq == std::string::npos) {
+                fprintf(stderr, "Invalid --set argument: %s\n", kv.c_str());
+                return 1;
+            }
+            std::string name = kv.substr(0, eq);
+            rtbi.floatUniforms[name] = (float)atof(kv.c_str() + eq + 1);
+            mouseSet |= name == "mouseX" || name == "mouseY";
+        }
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    if (rtbi.width <= 0 || rtbi.height <= 0) {
+        fprintf(stderr, "Invalid resolution %dx%d\n", rtbi.width, rtbi.height);
+        return 1;
+    }
+
+    // 未指定鼠标位置时放在屏幕中心
+    if (!mouseSet) {
+        rtbi.floatUniforms["mouseX"] = rtbi.width * 0.5f;
+        rtbi.floatUniforms["mouseY"] = rtbi.height * 0.5f;
+    }
+
+    // 加载纹理资源，与main.cpp使用相同的资源
+    CpuCubemap galaxy = loadCubemapCPU("assets/skybox_nebula_dark");
+    CpuTexture2D colorMap = loadTexture2DCPU("assets/color_map.png");
+    rtbi.cubemapUniforms["galaxy"] = &galaxy;
+    rtbi.textureUniforms["colorMap"] = &colorMap;
+
+    // 偏折角查找表，首次运行时计算并缓存到cache目录
+    DeflectionLUT deflectionLUT;
+    if (rtbi.floatUniforms["lensingLUT"] > 0.5f) {
+        deflectionLUT = loadOrComputeDeflectionLUT(DeflectionLUTInfo());
+        rtbi.deflectionLUT = &deflectionLUT;
+    }
+
+    if (bench) {
+        benchmarkKernels(rtbi);
+        return 0;
+    }
+    if (scaling) {
+        benchmarkScaling(rtbi);
+        return 0;
+    }
+
+    std::vector<float> buffer(size_t(rtbi.width) * rtbi.height * 3);
+    TileRenderStats stats;
+    DiskSampleCounters diskCounters;
+    rtbi.targetBuffer = buffer.data();
+    rtbi.stats = &stats;
+    rtbi.diskCounters = diskStats ? &diskCounters : nullptr;
+    renderToBuffer(rtbi);
+
+    if (diskStats) {
+        uint64_t evaluated = diskCounters.evaluated;
+        uint64_t skipped = diskCounters.skipped;
+        uint64_t total = evaluated + skipped;
+        printf("Disk samples: %llu evaluated, %llu skipped by bounds (%.1f%%)\n",
+            (unsigned long long)evaluated, (unsigned long long)skipped,
+            total ? skipped * 100.0 / total : 0.0);
+    }
+
+    if (!tileCostFile.empty() && !writeTileCostCSV(stats, tileCostFile)) {
+        fprintf(stderr, "Failed to write %s\n", tileCostFile.c_str());
+    }
+    if (!tileHistogramFile.empty() &&
+        !writeTileHistogramCSV(stats, tileHistogramFile)) {
+        fprintf(stderr, "Failed to write %s\n", tileHistogramFile.c_str());
+    }
+
+    if (!writePFM(outFile, buffer.data(), rtbi.width, rtbi.height)) {
+        fprintf(stderr, "Failed to write %s\n", outFile.c_str());
+        return 1;
+    }
+    printf("Wrote %dx%d frame to %s (%s kernel, %d threads, %.1f ms)\n",
+        rtbi.width, rtbi.height, outFile.c_str(),
+        (rtbi.kernel ? rtbi.kernel : &selectPacketKernel())->name,
+        stats.threadCount, stats.wallSeconds * 1000.0);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+#include "dynamic_resolution.h"
+
+#include <algorithm> // std::min, std::max
+#include <cmath> // std::sqrt, std::floor
+
+DynamicResolutionController::DynamicResolutionController(
+    const DynamicResolutionInfo& info)
+    : info(info), currentScale(info.maxScale) {}
+
+void DynamicResolutionController::reset() {
+    currentScale = info.maxScale;
+    smoothed = 0.0f;
+    cooldown = 0;
+}
+
+float DynamicResolutionController::update(float gpuMilliseconds) {
+    if (gpuMilliseconds <= 0.0f) {
+        return currentScale;
+    }
+    smoothed = smoothed > 0.0f
+        ? smoothed + info.smoothing * (gpuMilliseconds - smoothed)
+        : gpuMilliseconds;
+
+    if (cooldown > 0) {
+        cooldown--;
+        return currentScale;
+    }
+
+    float target = info.targetMilliseconds;
+    bool tooSlow = smoothed > target;
+    bool tooFast = smoothed < target * (1.0f - info.headroom);
+    if (!tooSlow && !tooFast) {
+        return currentScale;
+    }
+
+    // 瞄准滞回区间中点，向下取整到量化步长
+    float aim = target * (1.0f - 0.5f * info.headroom);
+    float desired = currentScale * std::sqrt(aim / smoothed);
+    desired = std::floor(desired / info.scaleStep) * info.scaleStep;
+    desired = std::min(std::max(desired, info.minScale), info.maxScale);
+    if (tooSlow) {
+        // 至少缩小一步，否则量化后可能一直停在超时的比例上
+        desired = std::max(std::min(desired, currentScale - info.scaleStep), info.minScale);
+    }
+    if (desired == currentScale || (tooFast && desired < currentScale)) {
+        return currentScale;
+    }
+
+    // 按像素数预测新比例下的耗时，避免等待平均值慢慢收敛
+    float ratio = desired / currentScale;
+    smoothed *= ratio * ratio;
+    currentScale = desired;
+    cooldown = info.cooldownFrames;
+    return currentScale;
+}
@@ -0,0 +1,38 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+struct DynamicResolutionInfo {
+  float targetMilliseconds = 16.6f; // 追踪通道的目标GPU时间
+  float minScale = 0.25f;
+  float maxScale = 1.0f;
+  // 滞回区间：高于目标时缩小，低于 target*(1-headroom) 时才放大，中间保持不变
+  float headroom = 0.2f;
+  float scaleStep = 1.0f / 16.0f; // 比例量化步长，避免每帧细微抖动
+  int cooldownFrames = 15;        // 两次调整之间至少间隔的帧数，覆盖查询延迟
+  float smoothing = 0.15f;        // 帧时间指数平均系数
+};
+
+// 根据GPU计时调整内部渲染比例（每个方向）。追踪开销与像素数成正比，
+// 即与比例的平方成正比，据此一次算出使时间落在滞回区间中点的比例
+class DynamicResolutionController {
+public:
+  explicit DynamicResolutionController(
+      const DynamicResolutionInfo &info = DynamicResolutionInfo());
+
+  // 每帧调用一次，gpuMilliseconds <= 0 表示没有新测量；返回当前比例
+  float update(float gpuMilliseconds);
+
+  void setTarget(float milliseconds) { info.targetMilliseconds = milliseconds; }
+  void reset();
+
+  float scale() const { return currentScale; }
+  float smoothedMilliseconds() const { return smoothed; }
+
+private:
+  DynamicResolutionInfo info;
+  float currentScale;
+  float smoothed = 0.0f;
+  int cooldown = 0;
+};
+
+#endif /* DYNAMIC_RESOLUTION_H */
@@ -1,7 +1,10 @@
 #include <cuda_runtime.h> // CUDA运行时
+#include <algorithm>
 #include <assert.h>
+#include <iostream>
 #include <map>
 #include <stdio.h>
+#include <string>
 #include <vector>
 
 #include <GL/glew.h> // GLEW库
@@ -15,29 +18,53 @@
 #include "GLDebugMessageCallback.h" // OpenGL调试回调
 #include "imgui_impl_glfw.h" // ImGui GLFW绑定
 #include "imgui_impl_opengl3.h" // ImGui OpenGL绑定
+#include "alloc_counter.h" // 堆分配计数
+#include "bloom_benchmark.h" // Bloom纹理格式对比
+#include "compute_bloom.h" // 计算着色器Bloom
+#include "dynamic_resolution.h" // 动态分辨率控制
 #include "render.h" // 渲染相关
+#include "render_graph.h" // 帧图
 #include "shader.h" // 着色器管理
 #include "texture.h" // 纹理管理
+#include "deflection_lut.h" // 偏折角查找表
 
 // 包含irrKlang头文件用于音频
 #include <irrKlang.h>
 
-static const int SCR_WIDTH = 1920; // 屏幕宽度
-static const int SCR_HEIGHT = 1080; // 屏幕高度
+static const int SCR_WIDTH = 1920; // 初始窗口宽度
+static const int SCR_HEIGHT = 1080; // 初始窗口高度
 
 static float mouseX, mouseY; // 鼠标位置
 
+// 以下宏作用于当前作用域中名为 pass 的 RenderPass：
+// 首次执行时注册槽位，之后每帧只按槽位下标更新值
+
 // 定义ImGui复选框宏
 #define IMGUI_TOGGLE(NAME, DEFAULT)                                            \
   static bool NAME = DEFAULT;                                                  \
   ImGui::Checkbox(#NAME, &NAME);                                               \
-  rtti.floatUniforms[#NAME] = NAME ? 1.0f : 0.0f;
+  static int NAME##Slot = pass.addFloat(#NAME);                                \
+  pass.setFloat(NAME##Slot, NAME ? 1.0f : 0.0f);
 
 // 定义ImGui滑动条宏
 #define IMGUI_SLIDER(NAME, DEFAULT, MIN, MAX)                                  \
   static float NAME = DEFAULT;                                                 \
   ImGui::SliderFloat(#NAME, &NAME, MIN, MAX);                                  \
-  rtti.floatUniforms[#NAME] = NAME;
+  static int NAME##Slot = pass.addFloat(#NAME);                                \
+  pass.setFloat(NAME##Slot, NAME);
+
+// 编译期开关：作为宏定义注入着色器，每种组合对应一个缓存的程序
+#define IMGUI_DEFINE_TOGGLE(NAME, MACRO, DEFAULT)                              \
+  static bool NAME = DEFAULT;                                                  \
+  ImGui::Checkbox(#NAME, &NAME);                                               \
+  static int NAME##Slot = pass.addDefine(MACRO);                               \
+  pass.setDefine(NAME##Slot, NAME ? 1 : 0);
+
+#define IMGUI_DEFINE_SLIDER_INT(NAME, MACRO, DEFAULT, MIN, MAX)                \
+  static int NAME = DEFAULT;                                                   \
+  ImGui::SliderInt(#NAME, &NAME, MIN, MAX);                                    \
+  static int NAME##Slot = pass.addDefine(MACRO);                               \
+  pass.setDefine(NAME##Slot, NAME);
 
 static void glfwErrorCallback(int error, const char* description) {
     // GLFW错误回调函数，输出错误信息
@@ -59,6 +86,8 @@ void mouseCallback(GLFWwindow* window, double x, double y) {
 class PostProcessPass {
 private:
     GLuint program; // 着色器程序
+    GLint resolutionLocation; // 链接后查询一次的uniform位置
+    GLint timeLocation;
 
 public:
     // 构造函数，创建着色器程序
@@ -68,26 +97,26 @@ public:
         glUseProgram(this->program);
         glUniform1i(glGetUniformLocation(program, "texture0"), 0); // 设置纹理单元
         glUseProgram(0);
+
+        this->resolutionLocation = glGetUniformLocation(program, "resolution");
+        this->timeLocation = glGetUniformLocation(program, "time");
     }
 
     // 渲染后处理
-    void render(GLuint inputColorTexture, GLuint destFramebuffer = 0) {
+    void render(GLuint inputColorTexture, int width, int height,
+        GLuint destFramebuffer = 0) {
         glBindFramebuffer(GL_FRAMEBUFFER, destFramebuffer); // 绑定帧缓冲
+        glViewport(0, 0, width, height); // 设置视口
 
         glDisable(GL_DEPTH_TEST); // 禁用深度测试
 
-        glClearColor(1.0f, 0.0f, 0.0f, 1.0f); // 清除颜色为红色
-        glClear(GL_COLOR_BUFFER_BIT); // 清除颜色缓冲
-
         glUseProgram(this->program); // 使用着色器程序
 
         // 设置分辨率Uniform
-        glUniform2f(glGetUniformLocation(this->program, "resolution"),
-            (float)SCR_WIDTH, (float)SCR_HEIGHT);
+        glUniform2f(this->resolutionLocation, (float)width, (float)height);
 
         // 设置时间Uniform
-        glUniform1f(glGetUniformLocation(this->program, "time"),
-            (float)glfwGetTime());
+        glUniform1f(this->timeLocation, (float)glfwGetTime());
 
         glActiveTexture(GL_TEXTURE0); // 激活纹理单元0
         glBindTexture(GL_TEXTURE_2D, inputColorTexture); // 绑定输入颜色纹理
@@ -98,6 +127,13 @@ public:
     }
 };
 
+// 输出目标由帧图在执行时指定的后处理通道
+static RenderPassInfo postPassInfo(const std::string& fragShader) {
+    RenderPassInfo info;
+    info.fragShader = fragShader;
+    return info;
+}
+
 int main(int, char**) {
     // 设置CUDA设备
     cudaSetDevice(1);
@@ -177,16 +213,6 @@ int main(int, char**) {
         ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
     }
 
-    // 创建黑洞帧缓冲和纹理
-    GLuint fboBlackhole, texBlackhole;
-    texBlackhole = createColorTexture(SCR_WIDTH, SCR_HEIGHT);
-
-    FramebufferCreateInfo info = {};
-    info.colorTexture = texBlackhole;
-    if (!(fboBlackhole = createFramebuffer(info))) {
-        assert(false); // 确认帧缓冲创建成功
-    }
-
     // 创建全屏四边形VAO
     GLuint quadVAO = createQuadVAO();
     glBindVertexArray(quadVAO);
@@ -219,138 +245,699 @@ int main(int, char**) {
 
         // ImGui::ShowDemoWindow(); // 显示ImGui示例窗口
 
+        // 所有离屏目标都按帧缓冲实际尺寸分配，尺寸变化时由帧图重建
         int width, height;
         glfwGetFramebufferSize(window, &width, &height); // 获取窗口大小
+        if (width == 0 || height == 0) {
+            // 窗口最小化时不渲染
+            ImGui::EndFrame();
+            glfwWaitEvents();
+            continue;
+        }
         glViewport(0, 0, width, height); // 设置视口
 
-        // renderScene(fboBlackhole); // 渲染场景到帧缓冲（注释掉）
-
         // 加载纹理资源
         static GLuint galaxy = loadCubemap("assets/skybox_nebula_dark");
         static GLuint colorMap = loadTexture2D("assets/color_map.png");
         static GLuint uvChecker = loadTexture2D("assets/uv_checker.png");
 
-        // 确保texBlackhole不被重新定义
-        // 移除以下行以防止重新定义
-        // static GLuint texBlackhole = createColorTexture(SCR_WIDTH, SCR_HEIGHT);
+        // 偏折角查找表，首次运行时计算并缓存到cache目录
+        static GLuint deflectionLUT = [] {
+            DeflectionLUT lut = loadOrComputeDeflectionLUT(DeflectionLUTInfo());
+            return createDataTexture2D(lut.info.angleCount, lut.info.radiusCount,
+                GL_RGBA32F, GL_RGBA, lut.texels.data());
+        }();
+
+        // 各通道在首次执行时创建并注册参数，之后每帧只更新参数值，执行时不再分配内存。
+        // 只统计通道执行期间的分配，界面、图的重建等不计入
+        uint64_t passAllocations = 0;
+
+        // 动态分辨率：按追踪通道的GPU耗时调整内部渲染比例，
+        // 低分辨率结果写在全尺寸纹理的左下角，再由边缘感知放大通道放大到窗口尺寸
+        static GpuTimer blackholeTimer;
+        static GpuTimer coarseTimer;
+        static GpuTimer lensingTimer; // 生成透镜映射的帧单独计时，不计入动态分辨率
+        static float extraTraceMs = 0.0f; // 上一帧在帧图之外追踪粗图或子像素光线的耗时
+        static DynamicResolutionController resolutionController;
+        static bool dynamicResolution = true;
+        static float targetFrameMs = 16.6f;
+        if (ImGui::Checkbox("dynamicResolution", &dynamicResolution) && !dynamicResolution) {
+            resolutionController.reset();
+        }
+        ImGui::SliderFloat("targetFrameMs", &targetFrameMs, 4.0f, 50.0f);
+        resolutionController.setTarget(targetFrameMs);
+        // 计时器没有读到新的查询时传0，不重复平均旧的测量
+        float renderScale = dynamicResolution
+            ? resolutionController.update(blackholeTimer.hasNewResult()
+                ? blackholeTimer.milliseconds() + extraTraceMs : 0.0f)
+            : 1.0f;
+        int renderWidth = std::max(1, (int)(width * renderScale));
+        int renderHeight = std::max(1, (int)(height * renderScale));
+        ImGui::Text("trace %.2f ms, render scale %.3f (%dx%d)",
+            blackholeTimer.milliseconds(), renderScale, renderWidth, renderHeight);
+
+        // 黑洞主通道，输出纹理由帧图分配
+        static RenderPass blackholePass = [&] {
+            RenderPass pass(postPassInfo("shader/blackhole_main.frag")); // 使用黑洞主片段着色器
+            pass.addTexture("galaxy", galaxy, GL_TEXTURE_CUBE_MAP); // 设置立方体贴图
+            pass.addTexture("colorMap", colorMap); // 设置颜色贴图
+            pass.addTexture("deflectionLUT", deflectionLUT); // 设置偏折角查找表
+            pass.setTimer(&blackholeTimer);
+            return pass;
+        }();
+        bool temporal = false; // 本帧是否启用时间累积
+        bool checker = false; // 本帧是否启用棋盘格渲染
+        bool historyValid = false; // 上一帧的结果能否复用
+        static uint32_t frameCounter = 0;
+        uint32_t frame = frameCounter++;
+        // 交替读写的历史纹理：时间累积时为完整尺寸的RGBA16F，a通道保存吸积盘遮罩；
+        // 棋盘格时为半宽图像
+        static GLuint historyTextures[2] = { 0, 0 };
+        static int historyIndex = 0; // 本帧读取的历史纹理
+        // 透镜映射缓存：每个像素的逃逸方向和透过率，视角稳定后生成一次
+        static GLuint lensingMapTexture = 0;
+        static int lensingMapSlot = blackholePass.addDefine("LENSING_MAP", 0, false);
+        // 吸积盘穿越缓存，与透镜映射同时生成：每张纹理记录一次穿越
+        static GLuint diskCrossingTextures[2] = {0, 0};
+        bool lensingBuild = false; // 本帧是否需要先生成透镜映射
+        // 由粗到细追踪：先以1/4分辨率追踪粗图，再只在亮度变化剧烈处逐像素追踪
+        bool coarse = false;
+        static GLuint coarseTexture = 0;
+        static int coarseWidth = 0, coarseHeight = 0;
+        static int coarseToFineSlot = blackholePass.addDefine("COARSE_TO_FINE", 0, false);
+        // 自适应超采样：单光线追踪、对比度预通道和子像素光线都在帧图之前执行，
+        // 结果作为外部纹理导入帧图
+        const int SUPERSAMPLE_RAYS = 4; // 每个标记像素的子像素光线数，与blackhole_main.frag一致
+        bool supersample = false;
+        static GLuint supersampleTexture = 0, supersampleMaskTexture = 0;
+        static int supersampleWidth = 0, supersampleHeight = 0;
+        static int supersampleSlot = blackholePass.addDefine("SUPERSAMPLE", 0, false);
+        static RenderPass supersampleMaskPass(postPassInfo("shader/supersample_mask.frag"));
+        static int supersampleMaskInput = supersampleMaskPass.addTexture("texture0");
+        static GpuTimer supersampleTimer;
+        static GpuQuery supersampleCounter(GL_SAMPLES_PASSED); // 通过丢弃测试的像素数
+        static float supersampleBudget = 2.0f; // 每帧子像素光线预算（百万条）
         {
-            // 设置渲染到纹理的信息
-            RenderToTextureInfo rtti;
-            rtti.fragShader = "shader/blackhole_main.frag"; // 使用黑洞主片段着色器
-            rtti.cubemapUniforms["galaxy"] = galaxy; // 设置立方体贴图
-            rtti.textureUniforms["colorMap"] = colorMap; // 设置颜色贴图
-            rtti.floatUniforms["mouseX"] = mouseX; // 设置鼠标X位置
-            rtti.floatUniforms["mouseY"] = mouseY; // 设置鼠标Y位置
-            rtti.targetTexture = texBlackhole; // 目标纹理
-            rtti.width = SCR_WIDTH; // 纹理宽度
-            rtti.height = SCR_HEIGHT; // 纹理高度
-
-            // 使用ImGui宏添加界面控件
+            RenderPass& pass = blackholePass;
+            static int mouseXSlot = pass.addFloat("mouseX", 0.0f, false);
+            static int mouseYSlot = pass.addFloat("mouseY", 0.0f, false);
+            pass.setFloat(mouseXSlot, mouseX * renderScale); // 设置鼠标X位置，与缩放后的分辨率一致
+            pass.setFloat(mouseYSlot, mouseY * renderScale); // 设置鼠标Y位置
+
+            // 使用宏定义ImGui控件
             // IMGUI_TOGGLE(gravitationalLensing, true);
-            IMGUI_TOGGLE(renderBlackHole, true);
+            IMGUI_DEFINE_TOGGLE(renderBlackHole, "RENDER_BLACK_HOLE", true);
             IMGUI_TOGGLE(mouseControl, true);
             IMGUI_SLIDER(cameraRoll, 0.0f, -180.0f, 180.0f);
             IMGUI_TOGGLE(frontView, false);
             IMGUI_TOGGLE(topView, false);
-            IMGUI_TOGGLE(adiskEnabled, true);
-            IMGUI_TOGGLE(adiskParticle, true);
+            IMGUI_DEFINE_TOGGLE(adiskEnabled, "ADISK_ENABLED", true);
+            IMGUI_DEFINE_TOGGLE(adiskParticle, "ADISK_PARTICLE", true);
             IMGUI_SLIDER(adiskDensityV, 2.0f, 0.0f, 10.0f);
             IMGUI_SLIDER(adiskDensityH, 4.0f, 0.0f, 10.0f);
             IMGUI_SLIDER(adiskHeight, 0.55f, 0.0f, 1.0f);
             IMGUI_SLIDER(adiskLit, 0.25f, 0.0f, 4.0f);
-            IMGUI_SLIDER(adiskNoiseLOD, 5.0f, 1.0f, 12.0f);
+            IMGUI_DEFINE_SLIDER_INT(adiskNoiseLOD, "ADISK_NOISE_LOD", 5, 1, 12);
             IMGUI_SLIDER(adiskNoiseScale, 0.8f, 0.0f, 10.0f);
             IMGUI_SLIDER(adiskSpeed, 0.5f, 0.0f, 1.0f);
+            IMGUI_DEFINE_TOGGLE(adaptiveStep, "ADAPTIVE_STEP", true);
+            IMGUI_SLIDER(stepTolerance, 0.003f, 0.0002f, 0.05f);
+            IMGUI_SLIDER(maxSteps, 300.0f, 10.0f, 1000.0f);
+            IMGUI_DEFINE_TOGGLE(earlyEscape, "EARLY_ESCAPE", true);
+            IMGUI_DEFINE_TOGGLE(escapeCorrection, "ESCAPE_CORRECTION", true);
+            IMGUI_SLIDER(escapeRadius, 12.0f, 2.0f, 30.0f);
+            IMGUI_DEFINE_TOGGLE(lensingLUT, "LENSING_LUT", true);
+            IMGUI_DEFINE_TOGGLE(planarOrbit, "PLANAR_ORBIT", true);
+            IMGUI_DEFINE_TOGGLE(impactClassify, "IMPACT_CLASSIFY", true);
+            IMGUI_DEFINE_TOGGLE(adiskBoundsDebug, "ADISK_BOUNDS_DEBUG", false);
+
+            // 时间累积：静止视角下每帧只追踪一部分像素块，其余从上一帧重投影
+            // 宏定义取值在下面与棋盘格开关一起决定，只设置一次，避免参数版本每帧变化
+            static bool temporalAccumulation = true;
+            ImGui::Checkbox("temporalAccumulation", &temporalAccumulation);
+            static int temporalAccumulationSlot = pass.addDefine("TEMPORAL_ACCUMULATION");
+            static int temporalLevels = 1;
+            ImGui::SliderInt("temporalLevels", &temporalLevels, 1, 2); // 每帧刷新1/4或1/16
+            static int temporalLevelsSlot = pass.addFloat("temporalLevels");
+            pass.setFloat(temporalLevelsSlot, (float)temporalLevels);
+            IMGUI_SLIDER(temporalMaxVelocity, 1.0f, 0.0f, 4.0f);
+
+            // 棋盘格渲染：每帧只追踪一半像素，由重建通道补齐，与时间累积互斥
+            IMGUI_DEFINE_TOGGLE(checkerboard, "CHECKERBOARD", false);
+            // 由粗到细追踪，同样与时间累积互斥，棋盘格优先。
+            // 宏定义在粗图和细化之间切换，不计入参数版本
+            static bool coarseToFine = false;
+            ImGui::Checkbox("coarseToFine", &coarseToFine);
+            IMGUI_SLIDER(coarseThreshold, 0.05f, 0.0f, 0.5f);
+            IMGUI_DEFINE_TOGGLE(coarseDebug, "COARSE_DEBUG", false);
+            // 自适应超采样，棋盘格和由粗到细优先
+            static bool adaptiveSupersample = false;
+            ImGui::Checkbox("adaptiveSupersample", &adaptiveSupersample);
+            ImGui::SliderFloat("supersampleBudget", &supersampleBudget, 0.1f, 8.0f);
+            checker = checkerboard;
+            coarse = coarseToFine && !checkerboard;
+            supersample = adaptiveSupersample && !checkerboard && !coarse;
+            temporal = temporalAccumulation && !checkerboard && !coarse && !supersample;
+            pass.setDefine(temporalAccumulationSlot, temporal ? 1 : 0);
+            pass.setDefine(coarseToFineSlot, coarse ? 2 : 0);
+
+            if (coarseTexture && (!coarse || coarseWidth != width || coarseHeight != height)) {
+                destroyColorTexture(coarseTexture);
+                coarseTexture = 0;
+            }
+            if (coarse && coarseTexture == 0) {
+                coarseTexture = createColorTexture((width + 3) / 4, (height + 3) / 4, GL_RGB16F);
+            }
+            coarseWidth = width;
+            coarseHeight = height;
+            static int coarseImageSlot = pass.addTexture("coarseImage");
+            static int fineWidthSlot = pass.addFloat("fineWidth", 0.0f, false);
+            static int fineHeightSlot = pass.addFloat("fineHeight", 0.0f, false);
+            pass.setTexture(coarseImageSlot, coarseTexture);
+            pass.setFloat(fineWidthSlot, (float)renderWidth);
+            pass.setFloat(fineHeightSlot, (float)renderHeight);
+
+            if (supersampleTexture && (!supersample || supersampleWidth != width ||
+                                       supersampleHeight != height)) {
+                destroyColorTexture(supersampleTexture);
+                destroyColorTexture(supersampleMaskTexture);
+                supersampleTexture = 0;
+                supersampleMaskTexture = 0;
+            }
+            if (supersample && supersampleTexture == 0) {
+                supersampleTexture = createColorTexture(width, height, GL_RGB16F);
+                supersampleMaskTexture = createColorTexture(width, height, GL_RGB16F);
+            }
+            supersampleWidth = width;
+            supersampleHeight = height;
+
+            // 按几帧前的超采样像素数调整阈值：超出预算时提高，明显低于预算时降低。
+            // 阈值每帧变化，不计入参数版本
+            static float supersampleThreshold = 0.1f;
+            if (supersample) {
+                double rays = (double)supersampleCounter.result() * SUPERSAMPLE_RAYS;
+                double budget = supersampleBudget * 1e6;
+                if (rays > budget) {
+                    supersampleThreshold = std::min(supersampleThreshold * 1.1f, 1.0f);
+                }
+                else if (rays < budget * 0.8) {
+                    supersampleThreshold = std::max(supersampleThreshold * 0.95f, 0.01f);
+                }
+            }
+            static int supersampleMaskSlot = pass.addTexture("supersampleMask");
+            static int supersampleThresholdSlot = pass.addFloat("supersampleThreshold", 0.0f, false);
+            pass.setTexture(supersampleMaskSlot, supersampleMaskTexture);
+            pass.setFloat(supersampleThresholdSlot, supersampleThreshold);
+
+            // 透镜映射缓存：视角和参数不变时不经过吸积盘的像素只按缓存的逃逸方向
+            // 重新采样旋转的天空盒。拖动视角或调参期间直接追踪，稳定后的第一帧生成映射
+            static bool lensingMapCache = true;
+            ImGui::Checkbox("lensingMapCache", &lensingMapCache);
+            ImGui::SameLine();
+            ImGui::Text("last build %.2f ms", lensingTimer.milliseconds());
+            bool timeDrivenCamera = !mouseControl && !frontView && !topView;
+            bool lensingCache = lensingMapCache && !checker && !timeDrivenCamera;
+
+            static int lensingWidth = 0, lensingHeight = 0;
+            static uint64_t lensingVersion = 0;
+            static float lensingScale = 0.0f;
+            static float lensingMouseX = 0.0f, lensingMouseY = 0.0f;
+            static bool lensingValid = false;
+            bool lensingChanged = pass.version() != lensingVersion ||
+                renderScale != lensingScale || lensingWidth != width ||
+                lensingHeight != height ||
+                (mouseControl && (mouseX != lensingMouseX || mouseY != lensingMouseY));
+            lensingVersion = pass.version();
+            lensingScale = renderScale;
+            lensingMouseX = mouseX;
+            lensingMouseY = mouseY;
+
+            if (lensingMapTexture && (!lensingCache || lensingWidth != width ||
+                                      lensingHeight != height)) {
+                destroyColorTexture(lensingMapTexture);
+                lensingMapTexture = 0;
+                for (GLuint &crossing : diskCrossingTextures) {
+                    destroyColorTexture(crossing);
+                    crossing = 0;
+                }
+            }
+            if (lensingCache && lensingMapTexture == 0) {
+                // RG为16位定点的八面体编码方向，比半精度浮点的xyz精确得多
+                lensingMapTexture = createDataTexture2D(width, height, GL_RGBA16, GL_RGBA, nullptr);
+                // 着色时从穿越处恢复积分，状态须保留32位浮点的精度
+                for (GLuint &crossing : diskCrossingTextures) {
+                    crossing = createDataTexture2D(width, height, GL_RGBA32F, GL_RGBA, nullptr);
+                }
+            }
+            lensingWidth = width;
+            lensingHeight = height;
 
-            renderToTexture(rtti); // 渲染到纹理
-        }
+            if (!lensingCache || lensingChanged) {
+                lensingValid = false;
+            }
+            lensingBuild = lensingCache && !lensingChanged && !lensingValid;
+            pass.setDefine(lensingMapSlot, lensingCache && !lensingChanged ? 2 : 0);
+            lensingValid = lensingValid || lensingBuild;
+            ImGui::Text("lensing map: %s", !lensingCache ? "off"
+                : lensingBuild ? "rebuilding" : lensingValid ? "cached" : "tracing");
+            static int lensingMapTextureSlot = pass.addTexture("lensingMap");
+            pass.setTexture(lensingMapTextureSlot, lensingMapTexture);
+            static int diskCrossingSlots[2] = {pass.addTexture("diskCrossings1"),
+                                               pass.addTexture("diskCrossings2")};
+            for (int i = 0; i < 2; i++) {
+                pass.setTexture(diskCrossingSlots[i], diskCrossingTextures[i]);
+            }
+            // 经过吸积盘的像素从缓存的穿越处重新积分盘内的一段，关闭时重新追踪
+            IMGUI_DEFINE_TOGGLE(diskCrossingCache, "DISK_CROSSING_CACHE", true);
+
+            // 模式或尺寸变化时释放并重新创建历史纹理
+            static int historyMode = 0; // 0 关闭，1 时间累积，2 棋盘格
+            static int historyWidth = 0, historyHeight = 0;
+            static bool historyReady = false; // 历史纹理中有上一帧的结果
+            static uint64_t historyVersion = 0;
+            static float historyScale = 0.0f;
+            static float prevMouseX = 0.0f, prevMouseY = 0.0f;
+            int mode = checker ? 2 : temporal ? 1 : 0;
+            if (mode != historyMode || historyWidth != width || historyHeight != height) {
+                for (GLuint& texture : historyTextures) {
+                    if (texture) {
+                        destroyColorTexture(texture);
+                        texture = 0;
+                    }
+                }
+                for (GLuint& texture : historyTextures) {
+                    if (mode == 1) {
+                        texture = createDataTexture2D(width, height, GL_RGBA16F, GL_RGBA, nullptr);
+                    }
+                    else if (mode == 2) {
+                        texture = createColorTexture((width + 1) / 2, height, GL_RGB16F);
+                    }
+                }
+                historyMode = mode;
+                historyWidth = width;
+                historyHeight = height;
+                historyReady = false;
+            }
 
-        // 创建亮度纹理
-        static GLuint texBrightness = createColorTexture(SCR_WIDTH, SCR_HEIGHT);
-        {
-            RenderToTextureInfo rtti;
-            rtti.fragShader = "shader/bloom_brightness_pass.frag"; // 亮度提取着色器
-            rtti.textureUniforms["texture0"] = texBlackhole; // 输入纹理
-            rtti.targetTexture = texBrightness; // 目标纹理
-            rtti.width = SCR_WIDTH;
-            rtti.height = SCR_HEIGHT;
-            renderToTexture(rtti); // 渲染到纹理
+            // 受跟踪的参数或渲染比例改变后，上一帧的结果不能复用
+            historyValid = mode != 0 && historyReady &&
+                pass.version() == historyVersion && renderScale == historyScale;
+            historyVersion = pass.version();
+            historyScale = renderScale;
+            historyReady = mode != 0;
+
+            static int historySlot = pass.addTexture("history");
+            static int historyValidSlot = pass.addFloat("historyValid", 0.0f, false);
+            static int frameIndexSlot = pass.addFloat("frameIndex", 0.0f, false);
+            static int prevMouseXSlot = pass.addFloat("prevMouseX", 0.0f, false);
+            static int prevMouseYSlot = pass.addFloat("prevMouseY", 0.0f, false);
+            static int checkerboardParitySlot = pass.addFloat("checkerboardParity", 0.0f, false);
+            static int fullWidthSlot = pass.addFloat("fullWidth", 0.0f, false);
+            pass.setTexture(historySlot, historyTextures[historyIndex]);
+            pass.setFloat(historyValidSlot, historyValid ? 1.0f : 0.0f);
+            pass.setFloat(frameIndexSlot, (float)(frame % 16)); // 16是所有周期的公倍数
+            pass.setFloat(prevMouseXSlot, prevMouseX);
+            pass.setFloat(prevMouseYSlot, prevMouseY);
+            pass.setFloat(checkerboardParitySlot, (float)(frame & 1));
+            pass.setFloat(fullWidthSlot, (float)renderWidth);
+            prevMouseX = mouseX * renderScale;
+            prevMouseY = mouseY * renderScale;
         }
 
+        // Bloom链及色调映射由帧图管理：中间纹理按生存期复用，未被使用的通道被剔除。
+        // 通道本身只创建一次，输入输出纹理由帧图在执行时绑定
         const int MAX_BLOOM_ITER = 8; // 最大Bloom迭代次数
-        static GLuint texDownsampled[MAX_BLOOM_ITER] = { 0 }; // 下采样纹理数组
-        static GLuint texUpsampled[MAX_BLOOM_ITER] = { 0 }; // 上采样纹理数组
-        if (texDownsampled[0] == 0) {
-            // 初始化下采样和上采样纹理
+        static RenderPass brightnessPass(postPassInfo("shader/bloom_brightness_pass.frag"));
+        static RenderPass downsamplePasses[MAX_BLOOM_ITER]; // 每级一个下采样通道
+        static RenderPass upsamplePasses[MAX_BLOOM_ITER]; // 每级一个上采样通道
+        static RenderPass compositePass(postPassInfo("shader/bloom_composite.frag"));
+        static RenderPass tonemappingPass(postPassInfo("shader/tonemapping.frag"));
+        // 合并Bloom、色调映射并直接输出到默认帧缓冲
+        static RenderPass finalPass(postPassInfo("shader/final_composite.frag"));
+
+        static RenderPass upscalePass(postPassInfo("shader/upscale.frag"));
+        static GpuTimer resolveTimer;
+        static RenderPass resolvePass = [] {
+            RenderPass pass(postPassInfo("shader/checkerboard_resolve.frag")); // 棋盘格重建
+            pass.setTimer(&resolveTimer);
+            return pass;
+        }();
+
+        static int brightnessInput = brightnessPass.addTexture("texture0");
+        static int downsampleInputs[MAX_BLOOM_ITER];
+        static int upsampleInputs[MAX_BLOOM_ITER];
+        static int upsampleSkipInputs[MAX_BLOOM_ITER]; // 同级下采样结果
+        static int compositeScene = compositePass.addTexture("texture0"); // 原始纹理
+        static int compositeBloom = compositePass.addTexture("texture1"); // Bloom纹理
+        static int tonemappingInput = tonemappingPass.addTexture("texture0");
+        static int finalScene = finalPass.addTexture("texture0");
+        static int finalBloom = finalPass.addTexture("texture1");
+        static int upscaleInput = upscalePass.addTexture("texture0");
+        static int upscaleSourceWidth = upscalePass.addFloat("sourceWidth");
+        static int upscaleSourceHeight = upscalePass.addFloat("sourceHeight");
+        static int resolveCurrent = resolvePass.addTexture("texture0");
+        static int resolvePrevious = resolvePass.addTexture("texture1");
+        static int resolveParity = resolvePass.addFloat("checkerboardParity", 0.0f, false);
+        static int resolveHistoryValid = resolvePass.addFloat("historyValid", 0.0f, false);
+        static bool bloomPassesCreated = false;
+        if (!bloomPassesCreated) {
             for (int i = 0; i < MAX_BLOOM_ITER; i++) {
-                texDownsampled[i] =
-                    createColorTexture(SCR_WIDTH >> (i + 1), SCR_HEIGHT >> (i + 1));
-                texUpsampled[i] = createColorTexture(SCR_WIDTH >> i, SCR_HEIGHT >> i);
+                downsamplePasses[i] = RenderPass(postPassInfo("shader/bloom_downsample.frag"));
+                downsampleInputs[i] = downsamplePasses[i].addTexture("texture0");
+                upsamplePasses[i] = RenderPass(postPassInfo("shader/bloom_upsample.frag"));
+                upsampleInputs[i] = upsamplePasses[i].addTexture("texture0");
+                upsampleSkipInputs[i] = upsamplePasses[i].addTexture("texture1");
             }
+            bloomPassesCreated = true;
+        }
+
+        // Bloom级数由分辨率决定，最小一级的短边不小于4像素
+        int bloomLevels = 1;
+        while (bloomLevels < MAX_BLOOM_ITER &&
+            (std::min(width, height) >> (bloomLevels + 1)) >= 4) {
+            bloomLevels++;
         }
 
         static int bloomIterations = MAX_BLOOM_ITER; // 当前Bloom迭代次数
-        ImGui::SliderInt("bloomIterations", &bloomIterations, 1, 8); // ImGui滑动条调整迭代次数
-        for (int level = 0; level < bloomIterations; level++) {
-            // 下采样过程
-            RenderToTextureInfo rtti;
-            rtti.fragShader = "shader/bloom_downsample.frag"; // 下采样着色器
-            rtti.textureUniforms["texture0"] =
-                level == 0 ? texBrightness : texDownsampled[level - 1]; // 输入纹理
-            rtti.targetTexture = texDownsampled[level]; // 目标下采样纹理
-            rtti.width = SCR_WIDTH >> (level + 1); // 缩小宽度
-            rtti.height = SCR_HEIGHT >> (level + 1); // 缩小高度
-            renderToTexture(rtti); // 渲染到纹理
+        ImGui::SliderInt("bloomIterations", &bloomIterations, 1, bloomLevels); // ImGui滑动条调整迭代次数
+        bloomIterations = std::min(bloomIterations, bloomLevels);
+        // 调试选项：关闭后恢复合成、色调映射和输出三个单独的通道
+        static bool fusedFinalPass = true;
+        ImGui::Checkbox("fusedFinalPass", &fusedFinalPass);
+        {
+            RenderPass& pass = compositePass;
+            IMGUI_SLIDER(bloomStrength, 0.1f, 0.0f, 1.0f); // 调整Bloom强度
+            static int finalBloomStrength = finalPass.addFloat("bloomStrength");
+            finalPass.setFloat(finalBloomStrength, bloomStrength);
+        }
+        {
+            RenderPass& pass = tonemappingPass;
+            IMGUI_TOGGLE(tonemappingEnabled, true); // 启用/禁用色调映射
+            IMGUI_SLIDER(gamma, 2.5f, 1.0f, 4.0f); // 调整Gamma值
+            static int finalTonemappingEnabled = finalPass.addFloat("tonemappingEnabled");
+            static int finalGamma = finalPass.addFloat("gamma");
+            finalPass.setFloat(finalTonemappingEnabled, tonemappingEnabled ? 1.0f : 0.0f);
+            finalPass.setFloat(finalGamma, gamma);
         }
 
-        for (int level = bloomIterations - 1; level >= 0; level--) {
-            // 上采样过程
-            RenderToTextureInfo rtti;
-            rtti.fragShader = "shader/bloom_upsample.frag"; // 上采样着色器
-            rtti.textureUniforms["texture0"] = level == bloomIterations - 1
-                ? texDownsampled[level]
-                : texUpsampled[level + 1]; // 输入纹理
-            rtti.textureUniforms["texture1"] =
-                level == 0 ? texBrightness : texDownsampled[level - 1]; // 另一个输入纹理
-            rtti.targetTexture = texUpsampled[level]; // 目标上采样纹理
-            rtti.width = SCR_WIDTH >> level; // 缩放宽度
-            rtti.height = SCR_HEIGHT >> level; // 缩放高度
-            renderToTexture(rtti); // 渲染到纹理
+        // 图结构只随分辨率、迭代次数和各模式开关变化，变化时重建并打印显存规划，
+        // 旧尺寸的纹理及其帧缓冲在重新编译时释放。渲染比例只改变视口，不触发重建
+        static RenderGraph bloomGraph;
+        static int graphWidth = 0, graphHeight = 0, graphIterations = 0;
+        static bool graphDynamicResolution = false;
+        static bool graphTemporal = false;
+        static bool graphChecker = false;
+        static bool graphSupersample = false;
+        static bool graphFusedBrightness = false;
+        static bool graphFusedFinal = false;
+        static bool graphComputeBloom = false;
+        static GLenum graphBloomFormat = 0;
+        static bool graphBenchmark = false;
+        static int blackholeResource = -1;
+        static int checkerPreviousResource = -1;
+        static int resolvePassIndex = -1;
+        static int texTonemapped = -1;
+        static int blackholePassIndex = -1;
+        // 计算着色器Bloom：金字塔存放在一张带mipmap的纹理中，下采样每次调度生成两级。
+        // 不支持GL 4.3时保留逐级的片段着色器通道
+        static ComputeBloom computeBloom;
+        static bool computeBloomSupported = ComputeBloom::supported();
+        static bool useComputeBloom = true;
+        if (computeBloomSupported) {
+            ImGui::Checkbox("computeBloom", &useComputeBloom);
+        }
+        bool computeBloomActive = computeBloomSupported && useComputeBloom;
+
+        // 亮部和Bloom金字塔的格式。R11F_G11F_B10F 每像素4字节，RGB16F 通常按
+        // 8字节存放；计算着色器不能以 RGB16F 读写图像，该路径改用 RGBA16F
+        static const GLenum bloomFormats[] = { GL_R11F_G11F_B10F, GL_RGB16F, GL_RGBA16F };
+        static int bloomFormatIndex = 0;
+        ImGui::Combo("bloomFormat", &bloomFormatIndex, "R11F_G11F_B10F\0RGB16F\0RGBA16F\0");
+        GLenum bloomFormat = bloomFormats[bloomFormatIndex];
+
+        // 格式对比：下一帧在图中加入一个读取亮部和场景的通道，依次用每种格式
+        // 执行Bloom链并与 RGBA16F 的输出比较，之后的一帧恢复原来的图
+        static bool bloomBenchmarkRequested = false;
+        static std::vector<BloomFormatResult> bloomBenchmarkResults;
+        if (ImGui::Button("benchmarkBloomFormats")) {
+            bloomBenchmarkRequested = true;
+        }
+        for (const BloomFormatResult& result : bloomBenchmarkResults) {
+            ImGui::Text("%s fragment: %.3f ms, %.1f MiB, max diff %d", internalFormatName(result.format),
+                result.fragment.milliseconds, result.fragment.megabytes, result.fragment.maxDifference);
+            if (result.compute.supported) {
+                ImGui::Text("%s compute: %.3f ms, %.1f MiB, max diff %d", internalFormatName(result.format),
+                    result.compute.milliseconds, result.compute.megabytes, result.compute.maxDifference);
+            }
         }
 
-        // 创建最终Bloom合成纹理
-        static GLuint texBloomFinal = createColorTexture(SCR_WIDTH, SCR_HEIGHT);
-        {
-            RenderToTextureInfo rtti;
-            rtti.fragShader = "shader/bloom_composite.frag"; // Bloom合成着色器
-            rtti.textureUniforms["texture0"] = texBlackhole; // 原始纹理
-            rtti.textureUniforms["texture1"] = texUpsampled[0]; // Bloom纹理
-            rtti.targetTexture = texBloomFinal; // 目标合成纹理
-            rtti.width = SCR_WIDTH;
-            rtti.height = SCR_HEIGHT;
+        // Bloom亮部由产生最终场景的通道以第二个颜色附件同时输出，省去一次全分辨率的读写
+        static bool fusedBrightness = true;
+        ImGui::Checkbox("fusedBrightness", &fusedBrightness);
+        static int blackholeBrightnessSlot = blackholePass.addDefine("BRIGHTNESS_OUTPUT", 0, false);
+        static int upscaleBrightnessSlot = upscalePass.addDefine("BRIGHTNESS_OUTPUT", 0, false);
+        static int resolveBrightnessSlot = resolvePass.addDefine("BRIGHTNESS_OUTPUT", 0, false);
+        if (graphWidth != width || graphHeight != height ||
+            graphIterations != bloomIterations ||
+            graphDynamicResolution != dynamicResolution || graphTemporal != temporal ||
+            graphChecker != checker || graphSupersample != supersample ||
+            graphFusedBrightness != fusedBrightness || graphFusedFinal != fusedFinalPass ||
+            graphComputeBloom != computeBloomActive || graphBloomFormat != bloomFormat ||
+            graphBenchmark != bloomBenchmarkRequested) {
+            graphWidth = width;
+            graphHeight = height;
+            graphIterations = bloomIterations;
+            graphDynamicResolution = dynamicResolution;
+            graphTemporal = temporal;
+            graphChecker = checker;
+            graphSupersample = supersample;
+            graphFusedBrightness = fusedBrightness;
+            graphFusedFinal = fusedFinalPass;
+            graphComputeBloom = computeBloomActive;
+            graphBloomFormat = bloomFormat;
+            graphBenchmark = bloomBenchmarkRequested;
+            bloomGraph.reset();
+
+            // 亮部由放大、棋盘格重建或黑洞通道中最后写入场景的一个输出。
+            // 超采样的结果在帧图之外生成，仍需单独的亮度提取通道
+            RenderPass* brightnessSource = nullptr;
+            if (fusedBrightness) {
+                brightnessSource = dynamicResolution ? &upscalePass
+                    : checker ? &resolvePass
+                    : supersample ? nullptr
+                    : &blackholePass;
+            }
+            blackholePass.setDefine(blackholeBrightnessSlot, brightnessSource == &blackholePass);
+            upscalePass.setDefine(upscaleBrightnessSlot, brightnessSource == &upscalePass);
+            resolvePass.setDefine(resolveBrightnessSlot, brightnessSource == &resolvePass);
+            int brightness = bloomGraph.createTexture("brightness", width, height, bloomFormat);
+
+            // 时间累积和棋盘格模式下黑洞通道写入跨帧保留的历史纹理，不参与别名分配。
+            // 超采样的结果在帧图之前生成，同样作为外部纹理导入
+            int scene;
+            if (checker) {
+                int halfWidth = (width + 1) / 2;
+                blackholeResource = bloomGraph.importTexture("checkerboard", 0, halfWidth, height);
+                checkerPreviousResource =
+                    bloomGraph.importTexture("checkerboardPrev", 0, halfWidth, height);
+                blackholePassIndex =
+                    bloomGraph.addPass("blackhole", &blackholePass, {}, blackholeResource);
+                scene = bloomGraph.createTexture("blackhole", width, height);
+                resolvePassIndex = bloomGraph.addPass("checkerboardResolve", &resolvePass,
+                    { { resolveCurrent, blackholeResource },
+                      { resolvePrevious, checkerPreviousResource } }, scene,
+                    brightnessSource == &resolvePass ? brightness : -1);
+            }
+            else if (supersample) {
+                scene = bloomGraph.importTexture("blackhole", 0, width, height);
+                blackholeResource = scene;
+                blackholePassIndex = -1;
+            }
+            else {
+                scene = temporal
+                    ? bloomGraph.importTexture("blackhole", 0, width, height)
+                    : bloomGraph.createTexture("blackhole", width, height);
+                blackholeResource = scene;
+                blackholePassIndex = bloomGraph.addPass("blackhole", &blackholePass, {}, scene,
+                    brightnessSource == &blackholePass ? brightness : -1);
+            }
+            if (dynamicResolution) {
+                int upscaled = bloomGraph.createTexture("upscaled", width, height);
+                bloomGraph.addPass("upscale", &upscalePass, { { upscaleInput, scene } }, upscaled,
+                    brightnessSource == &upscalePass ? brightness : -1);
+                scene = upscaled;
+            }
+            if (!brightnessSource) {
+                bloomGraph.addPass("brightness", &brightnessPass,
+                    { { brightnessInput, scene } }, brightness);
+            }
 
-            IMGUI_SLIDER(bloomStrength, 0.1f, 0.0f, 1.0f); // 调整Bloom强度
+            int upsampled;
+            if (computeBloomActive) {
+                // 金字塔纹理由ComputeBloom持有，第0级即最终的Bloom
+                computeBloom.resize(width, height, bloomLevels, bloomFormat);
+                upsampled = bloomGraph.importTexture("bloomPyramid", computeBloom.texture(),
+                    width, height);
+                bloomGraph.addCallbackPass("computeBloom", [brightness] {
+                    computeBloom.execute(bloomGraph.texture(brightness), bloomIterations);
+                }, { brightness }, upsampled);
+            }
+            else {
+                // 声明当前分辨率下的全部级别，超出迭代次数的级别无人读取，由帧图剔除
+                int downsampled[MAX_BLOOM_ITER];
+                for (int level = 0; level < bloomLevels; level++) {
+                    downsampled[level] = bloomGraph.createTexture(
+                        "downsampled" + std::to_string(level),
+                        width >> (level + 1), height >> (level + 1), bloomFormat); // 缩小尺寸
+                    bloomGraph.addPass("downsample" + std::to_string(level),
+                        &downsamplePasses[level],
+                        { { downsampleInputs[level], level == 0 ? brightness : downsampled[level - 1] } },
+                        downsampled[level]);
+                }
+
+                upsampled = downsampled[bloomIterations - 1];
+                for (int level = bloomIterations - 1; level >= 0; level--) {
+                    int target = bloomGraph.createTexture("upsampled" + std::to_string(level),
+                        width >> level, height >> level, bloomFormat); // 缩放尺寸
+                    bloomGraph.addPass("upsample" + std::to_string(level), &upsamplePasses[level],
+                        { { upsampleInputs[level], upsampled },
+                          { upsampleSkipInputs[level], level == 0 ? brightness : downsampled[level - 1] } },
+                        target);
+                    upsampled = target;
+                }
+            }
 
-            renderToTexture(rtti); // 渲染到纹理
-        }
+            if (bloomBenchmarkRequested) {
+                // 读取亮部和场景使两者保留到这里；输出不被任何通道使用，标记为图的输出避免剔除
+                int benchmarkOutput = bloomGraph.importTexture("bloomBenchmark", 0, width, height);
+                bloomGraph.addCallbackPass("bloomBenchmark", [brightness, scene] {
+                    BloomPasses passes = { downsamplePasses, downsampleInputs, upsamplePasses,
+                        upsampleInputs, upsampleSkipInputs, &finalPass, finalScene, finalBloom };
+                    bloomBenchmarkResults = benchmarkBloomFormats(passes,
+                        bloomGraph.texture(scene), bloomGraph.texture(brightness),
+                        graphWidth, graphHeight, bloomIterations,
+                        { GL_RGBA16F, GL_RGB16F, GL_R11F_G11F_B10F });
+                    printBloomBenchmark(std::cout, bloomBenchmarkResults);
+                }, { brightness, scene }, benchmarkOutput);
+                bloomGraph.markOutput(benchmarkOutput);
+            }
 
-        // 创建色调映射纹理
-        static GLuint texTonemapped = createColorTexture(SCR_WIDTH, SCR_HEIGHT);
-        {
-            RenderToTextureInfo rtti;
-            rtti.fragShader = "shader/tonemapping.frag"; // 色调映射着色器
-            rtti.textureUniforms["texture0"] = texBloomFinal; // 输入纹理
-            rtti.targetTexture = texTonemapped; // 目标纹理
-            rtti.width = SCR_WIDTH;
-            rtti.height = SCR_HEIGHT;
+            if (fusedFinalPass) {
+                // 纹理0即默认帧缓冲
+                int backbuffer = bloomGraph.importTexture("backbuffer", 0, width, height);
+                bloomGraph.addPass("final", &finalPass,
+                    { { finalScene, scene }, { finalBloom, upsampled } }, backbuffer);
+                bloomGraph.markOutput(backbuffer);
+                texTonemapped = -1;
+            }
+            else {
+                int bloomFinal = bloomGraph.createTexture("bloomFinal", width, height);
+                bloomGraph.addPass("composite", &compositePass,
+                    { { compositeScene, scene }, { compositeBloom, upsampled } }, bloomFinal);
+
+                texTonemapped = bloomGraph.createTexture("tonemapped", width, height);
+                bloomGraph.addPass("tonemapping", &tonemappingPass,
+                    { { tonemappingInput, bloomFinal } }, texTonemapped);
+                bloomGraph.markOutput(texTonemapped);
+            }
 
-            IMGUI_TOGGLE(tonemappingEnabled, true); // 启用/禁用色调映射
-            IMGUI_SLIDER(gamma, 2.5f, 1.0f, 4.0f); // 调整Gamma值
+            bloomGraph.compile();
+            bloomGraph.printMemoryPlan(std::cout);
+        }
+        ImGui::Text("bloom VRAM: %.1f MiB (%.1f MiB without aliasing)",
+            bloomGraph.pooledBytes() / (1024.0 * 1024.0),
+            bloomGraph.transientBytes() / (1024.0 * 1024.0));
+        if (computeBloomActive) {
+            // 计时结果滞后几帧；下采样两级共用一次调度
+            for (int k = 0; k < bloomIterations; k += 2) {
+                ImGui::Text("bloom down %d-%d: %.3f ms", k + 1, std::min(k + 2, bloomIterations),
+                    computeBloom.downsampleMilliseconds(k / 2));
+            }
+            for (int level = bloomIterations - 1; level >= 0; level--) {
+                ImGui::Text("bloom up %d: %.3f ms", level, computeBloom.upsampleMilliseconds(level));
+            }
+        }
+
+        if (checker) {
+            bloomGraph.setViewport(blackholePassIndex, (renderWidth + 1) / 2, renderHeight);
+            bloomGraph.setViewport(resolvePassIndex, renderWidth, renderHeight);
+            bloomGraph.setImportedTexture(checkerPreviousResource, historyTextures[historyIndex]);
+            resolvePass.setFloat(resolveParity, (float)(frame & 1));
+            resolvePass.setFloat(resolveHistoryValid, historyValid ? 1.0f : 0.0f);
+        }
+        else if (!supersample) {
+            bloomGraph.setViewport(blackholePassIndex, renderWidth, renderHeight);
+        }
+        if (dynamicResolution) {
+            upscalePass.setFloat(upscaleSourceWidth, (float)renderWidth);
+            upscalePass.setFloat(upscaleSourceHeight, (float)renderHeight);
+        }
+        if (temporal || checker) {
+            bloomGraph.setImportedTexture(blackholeResource, historyTextures[1 - historyIndex]);
+        }
+        if (lensingBuild) {
+            // 一次追踪同时写出透镜映射和两次穿越（三个颜色附件），
+            // 随后图中的黑洞通道按映射着色
+            blackholePass.setTimer(&lensingTimer);
+            blackholePass.setDefine(lensingMapSlot, 1);
+            blackholePass.setTarget(lensingMapTexture, renderWidth, renderHeight,
+                diskCrossingTextures[0], diskCrossingTextures[1]);
+            countAllocations(passAllocations, [&] { blackholePass.execute(); });
+            blackholePass.setDefine(lensingMapSlot, 2);
+            blackholePass.setTimer(&blackholeTimer);
+        }
+        extraTraceMs = 0.0f;
+        if (coarse) {
+            // 粗图单独计时，与细化的耗时一起作为动态分辨率的输入
+            blackholePass.setDefine(coarseToFineSlot, 1);
+            blackholePass.setTarget(coarseTexture, (renderWidth + 3) / 4, (renderHeight + 3) / 4);
+            blackholePass.setTimer(&coarseTimer);
+            countAllocations(passAllocations, [&] { blackholePass.execute(); });
+            blackholePass.setTimer(&blackholeTimer);
+            blackholePass.setDefine(coarseToFineSlot, 2);
+            extraTraceMs = coarseTimer.milliseconds();
+            ImGui::Text("coarse to fine: coarse %.2f ms + refine %.2f ms",
+                extraTraceMs, blackholeTimer.milliseconds());
+        }
+        if (supersample) {
+            // 单光线结果 -> 对比度遮罩 -> 标记像素的子像素光线覆盖写回同一纹理
+            blackholePass.setTarget(supersampleTexture, renderWidth, renderHeight);
+            countAllocations(passAllocations, [&] { blackholePass.execute(); });
+            supersampleMaskPass.setTexture(supersampleMaskInput, supersampleTexture);
+            supersampleMaskPass.setTarget(supersampleMaskTexture, renderWidth, renderHeight);
+            countAllocations(passAllocations, [&] { supersampleMaskPass.execute(); });
+            blackholePass.setDefine(supersampleSlot, 1);
+            blackholePass.setTimer(&supersampleTimer);
+            supersampleCounter.begin();
+            countAllocations(passAllocations, [&] { blackholePass.execute(); });
+            supersampleCounter.end();
+            blackholePass.setTimer(&blackholeTimer);
+            blackholePass.setDefine(supersampleSlot, 0);
+            bloomGraph.setImportedTexture(blackholeResource, supersampleTexture);
+            extraTraceMs = supersampleTimer.milliseconds();
+            ImGui::Text("supersample: %llu px (%.2f M rays), trace %.2f ms + %.2f ms",
+                (unsigned long long)supersampleCounter.result(),
+                supersampleCounter.result() * SUPERSAMPLE_RAYS / 1e6,
+                blackholeTimer.milliseconds(), extraTraceMs);
+        }
+        // 按顺序执行未被剔除的通道
+        countAllocations(passAllocations, [&] { bloomGraph.execute(); });
+        bloomBenchmarkRequested = false;
+        historyIndex = 1 - historyIndex; // 本帧输出成为下一帧的历史
+        if (checker) {
+            ImGui::Text("checkerboard: trace %.2f ms + resolve %.2f ms",
+                blackholeTimer.milliseconds(), resolveTimer.milliseconds());
+        }
 
-            renderToTexture(rtti); // 渲染到纹理
+        if (texTonemapped != -1) {
+            countAllocations(passAllocations, [&] { // 后处理渲染
+                passthrough.render(bloomGraph.texture(texTonemapped), width, height);
+            });
         }
 
-        passthrough.render(texTonemapped); // 后处理渲染
+        // 本帧通道执行中的堆分配次数，稳定后应为0（首帧及切换宏定义时会编译程序，
+        // 格式对比所在的一帧也会分配）
+        ImGui::Text("render allocations/frame: %llu", (unsigned long long)passAllocations);
 
         ImGui::Render(); // 渲染ImGui
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData()); // 绘制ImGui数据
@@ -1,19 +1,29 @@
 #include "render.h" // 渲染相关头文件
 #include "shader.h" // 着色器管理头文件
 
+#include <algorithm> // std::sort, std::find
+#include <array> // 帧缓冲缓存的键
 #include <iostream> // 输入输出流
+#include <set> // 已报告的缺失uniform
 
 #include <GLFW/glfw3.h> // GLFW库
 #include <glm/glm.hpp> // GLM数学库
 
+// 以颜色附件纹理为键缓存的帧缓冲，键依次为第一到第三个颜色附件（没有时为0）。
+// 纹理删除时须一并移除，否则复用同一名字的新纹理会取到旧的帧缓冲
+static std::map<std::array<GLuint, 3>, GLuint> textureFramebufferMap;
+
 // 创建颜色纹理
-GLuint createColorTexture(int width, int height, bool hdr) {
+GLuint createColorTexture(int width, int height, GLenum internalFormat) {
     GLuint colorTexture;
     glGenTextures(1, &colorTexture); // 生成纹理对象
 
+    // 不上传数据，像素类型只需与内部格式兼容
+    bool normalized = internalFormat == GL_RGB || internalFormat == GL_RGB8 ||
+        internalFormat == GL_RGBA || internalFormat == GL_RGBA8;
     glBindTexture(GL_TEXTURE_2D, colorTexture); // 绑定纹理
-    glTexImage2D(GL_TEXTURE_2D, 0, hdr ? GL_RGB16F : GL_RGB, width, height, 0,
-        GL_RGB, hdr ? GL_FLOAT : GL_UNSIGNED_BYTE, NULL); // 定义纹理图像
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0,
+        GL_RGB, normalized ? GL_UNSIGNED_BYTE : GL_FLOAT, NULL); // 定义纹理图像
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // 设置缩小过滤
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR); // 设置放大过滤
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR); // 重复设置缩小过滤（可能为冗余）
@@ -22,6 +32,55 @@ GLuint createColorTexture(int width, int height, bool hdr) {
     return colorTexture; // 返回生成的纹理ID
 }
 
+size_t bytesPerPixel(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R11F_G11F_B10F:
+    case GL_RGB8:
+    case GL_RGBA8:
+    case GL_RGB:
+    case GL_RGBA:
+        return 4;
+    case GL_RGB16F: // 通常补齐到 RGBA16F
+    case GL_RGBA16F:
+        return 8;
+    case GL_RGB32F: // 通常补齐到 RGBA32F
+    case GL_RGBA32F:
+        return 16;
+    default:
+        return 8;
+    }
+}
+
+const char* internalFormatName(GLenum internalFormat) {
+    switch (internalFormat) {
+    case GL_R11F_G11F_B10F: return "R11F_G11F_B10F";
+    case GL_RGB16F: return "RGB16F";
+    case GL_RGBA16F: return "RGBA16F";
+    case GL_RGB32F: return "RGB32F";
+    case GL_RGBA32F: return "RGBA32F";
+    case GL_RGB8: return "RGB8";
+    case GL_RGBA8: return "RGBA8";
+    case GL_RGB: return "RGB";
+    case GL_RGBA: return "RGBA";
+    default: return "unknown";
+    }
+}
+
+// 删除颜色纹理及以它为任一附件缓存的帧缓冲
+void destroyColorTexture(GLuint texture) {
+    for (auto it = textureFramebufferMap.begin(); it != textureFramebufferMap.end();) {
+        const std::array<GLuint, 3>& attachments = it->first;
+        if (std::find(attachments.begin(), attachments.end(), texture) != attachments.end()) {
+            glDeleteFramebuffers(1, &it->second);
+            it = textureFramebufferMap.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    glDeleteTextures(1, &texture);
+}
+
 // 创建帧缓冲对象
 GLuint createFramebuffer(const FramebufferCreateInfo& info) {
     GLuint framebuffer;
@@ -30,9 +89,16 @@ GLuint createFramebuffer(const FramebufferCreateInfo& info) {
     glGenFramebuffers(1, &framebuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
 
-    // 绑定颜色附件
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-        info.colorTexture, 0);
+    // 绑定颜色附件，并让片段着色器的每个输出写入对应的附件
+    std::vector<GLenum> drawBuffers;
+    for (size_t i = 0; i < info.colorTextures.size(); i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (GLenum)i,
+            GL_TEXTURE_2D, info.colorTextures[i], 0);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+    }
+    if (!drawBuffers.empty()) {
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    }
 
     if (info.createDepthBuffer) {
         // 创建用于深度和模板的渲染缓冲对象
@@ -98,51 +164,156 @@ GLuint createQuadVAO() {
     return vao; // 返回生成的VAO ID
 }
 
-// 绑定纹理到指定的纹理单元
-static bool bindToTextureUnit(GLuint program, const std::string& name,
-    GLenum textureType, GLuint texture,
-    int textureUnitIndex) {
-    GLint loc = glGetUniformLocation(program, name.c_str()); // 获取Uniform位置
-    if (loc != -1) {
-        glUniform1i(loc, textureUnitIndex); // 设置Uniform为纹理单元索引
+// 着色器中一个活动uniform的反射信息
+struct UniformInfo {
+    std::string name;
+    GLint location;
+    int textureUnit; // 采样器固定使用的纹理单元，非采样器为-1
+};
+
+// 着色器程序的反射表，链接后构建一次
+struct ProgramInfo {
+    GLuint program = 0;
+    std::vector<UniformInfo> uniforms; // 按名字排序
+    GLint resolutionLocation = -1;
+    GLint timeLocation = -1;
+    std::set<std::string> missing; // 已报告过的缺失uniform，每个名字只警告一次
+};
+
+static bool isSamplerType(GLenum type) {
+    switch (type) {
+    case GL_SAMPLER_1D:
+    case GL_SAMPLER_2D:
+    case GL_SAMPLER_3D:
+    case GL_SAMPLER_CUBE:
+    case GL_SAMPLER_2D_ARRAY:
+        return true;
+    default:
+        return false;
+    }
+}
 
-        // 激活并绑定纹理
-        glActiveTexture(GL_TEXTURE0 + textureUnitIndex);
-        glBindTexture(textureType, texture);
-        return true; // 绑定成功
+// 用glGetActiveUniform枚举程序的活动uniform，为每个采样器分配固定的纹理单元
+static ProgramInfo reflectProgram(GLuint program) {
+    ProgramInfo info;
+    info.program = program;
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    std::vector<GLchar> nameBuffer(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)nameBuffer.size(), &length,
+            &size, &type, nameBuffer.data());
+
+        UniformInfo uniform;
+        uniform.name.assign(nameBuffer.data(), length);
+        if (uniform.name.size() > 3 &&
+            uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0) {
+            uniform.name.resize(uniform.name.size() - 3); // 数组以首元素的名字返回
+        }
+        uniform.location = glGetUniformLocation(program, uniform.name.c_str());
+        uniform.textureUnit = isSamplerType(type) ? 0 : -1;
+        if (uniform.location != -1) { // 跳过uniform块中的成员
+            info.uniforms.push_back(uniform);
+        }
     }
-    else {
-        std::cout << "WARNING: uniform " << name << " is not found in shader"
-            << std::endl;
-        return false; // 绑定失败
+    std::sort(info.uniforms.begin(), info.uniforms.end(),
+        [](const UniformInfo& a, const UniformInfo& b) { return a.name < b.name; });
+
+    // 采样器的纹理单元在程序的生命周期内不变，这里设置一次
+    glUseProgram(program);
+    int textureUnit = 0;
+    for (UniformInfo& uniform : info.uniforms) {
+        if (uniform.textureUnit != -1) {
+            uniform.textureUnit = textureUnit++;
+            glUniform1i(uniform.location, uniform.textureUnit);
+        }
+        if (uniform.name == "resolution") {
+            info.resolutionLocation = uniform.location;
+        }
+        else if (uniform.name == "time") {
+            info.timeLocation = uniform.location;
+        }
     }
+    glUseProgram(0);
+
+    return info;
 }
 
-// 渲染到纹理
-void renderToTexture(const RenderToTextureInfo& rtti) {
-    // 延迟创建帧缓冲并将纹理附加为颜色附件
-    static std::map<GLuint, GLuint> textureFramebufferMap;
-    GLuint targetFramebuffer;
-    if (!textureFramebufferMap.count(rtti.targetTexture)) {
+// 按名字有序的值表与反射表同步遍历，每个值只需一次前移比较，不做字符串查找。
+// 着色器中不存在的名字只在第一次出现时警告
+template <typename Values, typename Fn>
+static void forEachUniform(ProgramInfo& info, const Values& values, Fn fn) {
+    auto it = info.uniforms.begin();
+    for (auto const& [name, value] : values) {
+        while (it != info.uniforms.end() && it->name < name) {
+            ++it;
+        }
+        if (it != info.uniforms.end() && it->name == name) {
+            fn(*it, value);
+        }
+        else if (info.missing.insert(name).second) {
+            std::cout << "WARNING: uniform " << name << " is not found in shader"
+                << std::endl;
+        }
+    }
+}
+
+// 延迟创建帧缓冲并将纹理附加为颜色附件，纹理0对应默认帧缓冲
+static GLuint getFramebuffer(GLuint texture, GLuint secondTexture = 0,
+    GLuint thirdTexture = 0) {
+    if (texture == 0) {
+        return 0;
+    }
+    std::array<GLuint, 3> key = { texture, secondTexture, thirdTexture };
+    auto it = textureFramebufferMap.find(key);
+    if (it == textureFramebufferMap.end()) {
         FramebufferCreateInfo createInfo;
-        createInfo.colorTexture = rtti.targetTexture;
-        targetFramebuffer = createFramebuffer(createInfo); // 创建帧缓冲
-        textureFramebufferMap[rtti.targetTexture] = targetFramebuffer; // 存储映射
+        for (GLuint attachment : key) {
+            if (attachment) {
+                createInfo.colorTextures.push_back(attachment);
+            }
+        }
+        it = textureFramebufferMap.emplace(key, createFramebuffer(createInfo)).first; // 存储映射
     }
-    else {
-        targetFramebuffer = textureFramebufferMap[rtti.targetTexture]; // 获取已有帧缓冲
+    return it->second;
+}
+
+// 延迟加载着色器程序，按(片段着色器, 宏定义)缓存，切换选项时不重复编译
+static ProgramInfo& getProgram(const std::string& vertexShader,
+    const std::string& fragShader, const ShaderDefines& defines) {
+    static std::map<std::pair<std::string, ShaderDefines>, ProgramInfo> shaderProgramMap;
+    auto programKey = std::make_pair(fragShader, defines);
+    auto it = shaderProgramMap.find(programKey);
+    if (it == shaderProgramMap.end()) {
+        GLuint program = createShaderProgram(vertexShader, fragShader, defines); // 创建着色器程序
+        it = shaderProgramMap.emplace(programKey, reflectProgram(program)).first; // 存储映射
     }
+    return it->second;
+}
 
-    // 延迟加载着色器程序
-    static std::map<std::string, GLuint> shaderProgramMap;
-    GLuint program;
-    if (!shaderProgramMap.count(rtti.fragShader)) {
-        program = createShaderProgram(rtti.vertexShader, rtti.fragShader); // 创建着色器程序
-        shaderProgramMap[rtti.fragShader] = program; // 存储映射
+// 在按名字排序的反射表中查找uniform，不存在时只警告一次
+static const UniformInfo* findUniform(ProgramInfo& info, const std::string& name) {
+    auto it = std::lower_bound(info.uniforms.begin(), info.uniforms.end(), name,
+        [](const UniformInfo& uniform, const std::string& n) { return uniform.name < n; });
+    if (it != info.uniforms.end() && it->name == name) {
+        return &*it;
     }
-    else {
-        program = shaderProgramMap[rtti.fragShader]; // 获取已有程序
+    if (info.missing.insert(name).second) {
+        std::cout << "WARNING: uniform " << name << " is not found in shader"
+            << std::endl;
     }
+    return nullptr;
+}
+
+// 渲染到纹理
+void renderToTexture(const RenderToTextureInfo& rtti) {
+    GLuint targetFramebuffer = getFramebuffer(rtti.targetTexture);
+    ProgramInfo& programInfo = getProgram(rtti.vertexShader, rtti.fragShader, rtti.defines);
 
     // 渲染全屏四边形
     {
@@ -155,36 +326,36 @@ void renderToTexture(const RenderToTextureInfo& rtti) {
         glClearColor(0.0f, 1.0f, 1.0f, 1.0f); // 设置清除颜色为青色
         glClear(GL_COLOR_BUFFER_BIT); // 清除颜色缓冲
 
-        glUseProgram(program); // 使用着色器程序
+        glUseProgram(programInfo.program); // 使用着色器程序
 
-        // 设置Uniform变量
+        // 设置Uniform变量，location和纹理单元均来自反射表
         {
-            glUniform2f(glGetUniformLocation(program, "resolution"),
-                (float)rtti.width, (float)rtti.height); // 设置分辨率
-
-            glUniform1f(glGetUniformLocation(program, "time"), (float)glfwGetTime()); // 设置时间
-
-            // 更新浮点型Uniform变量
-            for (auto const& [name, val] : rtti.floatUniforms) {
-                GLint loc = glGetUniformLocation(program, name.c_str());
-                if (loc != -1) {
-                    glUniform1f(loc, val); // 设置Uniform值
-                }
-                else {
-                    std::cout << "WARNING: uniform " << name << " is not found"
-                        << std::endl;
-                }
+            if (programInfo.resolutionLocation != -1) {
+                glUniform2f(programInfo.resolutionLocation, (float)rtti.width,
+                    (float)rtti.height); // 设置分辨率
             }
-
-            // 更新纹理Uniform变量
-            int textureUnit = 0;
-            for (auto const& [name, texture] : rtti.textureUniforms) {
-                bindToTextureUnit(program, name, GL_TEXTURE_2D, texture, textureUnit++); // 绑定2D纹理
-            }
-            for (auto const& [name, texture] : rtti.cubemapUniforms) {
-                bindToTextureUnit(program, name, GL_TEXTURE_CUBE_MAP, texture,
-                    textureUnit++); // 绑定立方体贴图
+            if (programInfo.timeLocation != -1) {
+                glUniform1f(programInfo.timeLocation, (float)glfwGetTime()); // 设置时间
             }
+
+            // 更新浮点型Uniform变量
+            forEachUniform(programInfo, rtti.floatUniforms,
+                [](const UniformInfo& uniform, float val) {
+                    glUniform1f(uniform.location, val); // 设置Uniform值
+                });
+
+            // 绑定纹理到采样器固定的纹理单元
+            auto bindTexture = [](GLenum textureType) {
+                return [textureType](const UniformInfo& uniform, GLuint texture) {
+                    if (uniform.textureUnit != -1) {
+                        glActiveTexture(GL_TEXTURE0 + uniform.textureUnit);
+                        glBindTexture(textureType, texture);
+                    }
+                };
+            };
+            forEachUniform(programInfo, rtti.textureUniforms, bindTexture(GL_TEXTURE_2D)); // 绑定2D纹理
+            forEachUniform(programInfo, rtti.cubemapUniforms,
+                bindTexture(GL_TEXTURE_CUBE_MAP)); // 绑定立方体贴图
         }
 
         glDrawArrays(GL_TRIANGLES, 0, 6); // 绘制两组三角形
@@ -192,3 +363,139 @@ void renderToTexture(const RenderToTextureInfo& rtti) {
         glUseProgram(0); // 解绑着色器程序
     }
 }
+
+RenderPass::RenderPass(const RenderPassInfo& info) : info(info) {
+    framebuffer = getFramebuffer(info.targetTexture);
+}
+
+int RenderPass::addFloat(const std::string& name, float value, bool tracked) {
+    floats.push_back({ name, value, tracked });
+    variants.clear(); // 已解析的位置不含新槽位
+    current = nullptr;
+    return (int)floats.size() - 1;
+}
+
+int RenderPass::addTexture(const std::string& name, GLuint texture, GLenum target) {
+    textures.push_back({ name, texture, target });
+    variants.clear();
+    current = nullptr;
+    return (int)textures.size() - 1;
+}
+
+int RenderPass::addDefine(const std::string& name, int value, bool tracked) {
+    defineNames.push_back(name);
+    defineValues.push_back(value);
+    defineTracked.push_back(tracked);
+    variants.clear();
+    current = nullptr;
+    return (int)defineNames.size() - 1;
+}
+
+// 每次都重新查找帧缓冲：纹理被删除后其名字可能被新纹理复用
+void RenderPass::setTarget(GLuint texture, int width, int height, GLuint secondTexture,
+    GLuint thirdTexture) {
+    info.targetTexture = texture;
+    framebuffer = getFramebuffer(texture, secondTexture, thirdTexture);
+    info.width = width;
+    info.height = height;
+}
+
+// 宏定义取值未变时直接返回上次的结果，只比较整数数组
+const RenderPass::Variant& RenderPass::resolveVariant() {
+    if (current && currentKey == defineValues) {
+        return *current;
+    }
+
+    auto it = variants.find(defineValues);
+    if (it == variants.end()) {
+        ShaderDefines defines;
+        for (size_t i = 0; i < defineNames.size(); i++) {
+            defines[defineNames[i]] = std::to_string(defineValues[i]);
+        }
+        ProgramInfo& programInfo = getProgram(info.vertexShader, info.fragShader, defines);
+
+        Variant variant;
+        variant.program = programInfo.program;
+        variant.resolutionLocation = programInfo.resolutionLocation;
+        variant.timeLocation = programInfo.timeLocation;
+        for (const FloatSlot& slot : floats) {
+            const UniformInfo* uniform = findUniform(programInfo, slot.name);
+            variant.floatLocations.push_back(uniform ? uniform->location : -1);
+        }
+        for (const TextureSlot& slot : textures) {
+            const UniformInfo* uniform = findUniform(programInfo, slot.name);
+            variant.textureUnits.push_back(uniform ? uniform->textureUnit : -1);
+        }
+        it = variants.emplace(defineValues, std::move(variant)).first;
+    }
+
+    current = &it->second;
+    currentKey = defineValues; // 容量不变时不重新分配
+    return *current;
+}
+
+void RenderPass::execute() {
+    const Variant& variant = resolveVariant();
+
+    if (timer) {
+        timer->begin();
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer); // 绑定目标帧缓冲
+    glViewport(0, 0, info.width, info.height); // 设置视口大小
+    glDisable(GL_DEPTH_TEST); // 禁用深度测试
+
+    glUseProgram(variant.program); // 使用着色器程序
+    if (variant.resolutionLocation != -1) {
+        glUniform2f(variant.resolutionLocation, (float)info.width, (float)info.height);
+    }
+    if (variant.timeLocation != -1) {
+        glUniform1f(variant.timeLocation, (float)glfwGetTime());
+    }
+    for (size_t i = 0; i < floats.size(); i++) {
+        if (variant.floatLocations[i] != -1) {
+            glUniform1f(variant.floatLocations[i], floats[i].value);
+        }
+    }
+    for (size_t i = 0; i < textures.size(); i++) {
+        if (variant.textureUnits[i] != -1) {
+            glActiveTexture(GL_TEXTURE0 + variant.textureUnits[i]);
+            glBindTexture(textures[i].target, textures[i].texture);
+        }
+    }
+
+    glDrawArrays(GL_TRIANGLES, 0, 6); // 绘制两组三角形
+    glUseProgram(0); // 解绑着色器程序
+
+    if (timer) {
+        timer->end();
+    }
+}
+
+void GpuQuery::begin() {
+    if (queries[0] == 0) {
+        glGenQueries(QUERY_COUNT, queries);
+    }
+
+    // 按发出顺序读取已完成的查询；全部查询都在途时只能等待最早的一个
+    newResult = false;
+    while (pending > 0) {
+        GLuint query = queries[(next - pending + QUERY_COUNT) % QUERY_COUNT];
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available && pending < QUERY_COUNT) {
+            break;
+        }
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &lastResult);
+        newResult = true;
+        pending--;
+    }
+
+    glBeginQuery(target, queries[next]);
+}
+
+void GpuQuery::end() {
+    glEndQuery(target);
+    next = (next + 1) % QUERY_COUNT;
+    pending++;
+}
@@ -1,16 +1,31 @@
 #ifndef RENDER_H
 #define RENDER_H
 
+#include <cstddef>
+#include <cstdint>
 #include <map>
 #include <string>
 #include <vector>
 
 #include <GL/glew.h>
 
-GLuint createColorTexture(int width, int height, bool hdr = true);
+#include "shader.h"
+
+// 创建颜色纹理，内部格式例如 GL_RGB16F、GL_RGBA16F 或 GL_R11F_G11F_B10F
+GLuint createColorTexture(int width, int height, GLenum internalFormat);
+
+// 每像素的显存字节数，用于显存和带宽估算。驱动通常把 GL_RGB16F 按
+// 4通道存放，按8字节计
+size_t bytesPerPixel(GLenum internalFormat);
+// 用于日志和界面的格式名，例如 "R11F_G11F_B10F"
+const char *internalFormatName(GLenum internalFormat);
+
+// 删除纹理，同时释放 renderToTexture/RenderPass 为它缓存的所有帧缓冲
+void destroyColorTexture(GLuint texture);
 
 struct FramebufferCreateInfo {
-  GLuint colorTexture = 0;
+  // 依次附加到 GL_COLOR_ATTACHMENT0, 1, ...，片段着色器按 location 写入
+  std::vector<GLuint> colorTextures;
   int width = 256;
   int height = 256;
   bool createDepthBuffer = false;
@@ -23,6 +38,7 @@ GLuint createQuadVAO();
 struct RenderToTextureInfo {
   std::string vertexShader = "shader/simple.vert";
   std::string fragShader;
+  ShaderDefines defines; // 每种组合编译为单独的程序并缓存
   std::map<std::string, float> floatUniforms;
   std::map<std::string, GLuint> textureUniforms;
   std::map<std::string, GLuint> cubemapUniforms;
@@ -33,4 +49,131 @@ struct RenderToTextureInfo {
 
 void renderToTexture(const RenderToTextureInfo &rtti);
 
+// 异步GPU查询（GL_TIME_ELAPSED、GL_SAMPLES_PASSED等）。多个查询轮换使用，
+// 只读取已经完成的结果，结果比当前帧滞后几帧但不会阻塞CPU
+class GpuQuery {
+public:
+  explicit GpuQuery(GLenum target) : target(target) {}
+
+  void begin();
+  void end();
+
+  // 最近一次完成的查询结果，尚无结果时为0
+  GLuint64 result() const { return lastResult; }
+  // 上一次 begin() 是否读到了新完成的查询。每帧 begin() 一次时，
+  // 据此区分新的测量和重复读取的旧结果
+  bool hasNewResult() const { return newResult; }
+
+private:
+  static const int QUERY_COUNT = 4;
+  GLenum target;
+  GLuint queries[QUERY_COUNT] = {0};
+  int next = 0;    // 下一个要使用的查询
+  int pending = 0; // 已发出但尚未读取的查询数
+  GLuint64 lastResult = 0;
+  bool newResult = false;
+};
+
+// 基于 GL_TIME_ELAPSED 查询的GPU计时器
+class GpuTimer : public GpuQuery {
+public:
+  GpuTimer() : GpuQuery(GL_TIME_ELAPSED) {}
+
+  // 最近一次完成的测量（毫秒），尚无结果时为0
+  float milliseconds() const { return (float)(result() * 1e-6); }
+};
+
+struct RenderPassInfo {
+  std::string vertexShader = "shader/simple.vert";
+  std::string fragShader;
+  GLuint targetTexture = 0; // 0 表示输出到默认帧缓冲
+  int width = 0;
+  int height = 0;
+};
+
+// 预先解析好的渲染通道。参数按名字声明一次得到槽位下标，之后每帧只按下标
+// 更新值再调用 execute()，执行过程不分配堆内存也不做字符串查找。
+// 宏定义槽位的每种取值组合对应一个程序，首次出现时编译并解析 uniform 位置
+class RenderPass {
+public:
+  RenderPass() = default;
+  explicit RenderPass(const RenderPassInfo &info);
+  // 缓存的 current 指向自身 variants 中的元素，复制后会指向原对象；
+  // 移动时 map 的节点连同元素一起转移，指针仍然有效
+  RenderPass(const RenderPass &) = delete;
+  RenderPass &operator=(const RenderPass &) = delete;
+  RenderPass(RenderPass &&) = default;
+  RenderPass &operator=(RenderPass &&) = default;
+
+  // tracked 为 false 的参数（鼠标、帧序号等每帧变化的量）不影响 version()
+  int addFloat(const std::string &name, float value = 0.0f,
+               bool tracked = true);
+  int addTexture(const std::string &name, GLuint texture = 0,
+                 GLenum target = GL_TEXTURE_2D);
+  int addDefine(const std::string &name, int value = 0, bool tracked = true);
+
+  void setFloat(int slot, float value) {
+    if (floats[slot].tracked && floats[slot].value != value) {
+      parameterVersion++;
+    }
+    floats[slot].value = value;
+  }
+  void setTexture(int slot, GLuint texture) { textures[slot].texture = texture; }
+  void setDefine(int slot, int value) {
+    if (defineTracked[slot] && defineValues[slot] != value) {
+      parameterVersion++;
+    }
+    defineValues[slot] = value;
+  }
+
+  // 受跟踪的参数或宏定义取值每改变一次加一，用于判断上一帧的结果能否复用
+  uint64_t version() const { return parameterVersion; }
+
+  // 更换输出纹理，帧缓冲按纹理缓存。width/height 为视口尺寸，
+  // 可小于纹理尺寸，此时只写入纹理左下角。secondTexture、thirdTexture 非0时
+  // 依次作为第二、第三个颜色附件（着色器中 location = 1、2 的输出），尺寸须相同
+  void setTarget(GLuint texture, int width, int height,
+                 GLuint secondTexture = 0, GLuint thirdTexture = 0);
+
+  // 为 execute() 计时，传入 nullptr 取消
+  void setTimer(GpuTimer *timer) { this->timer = timer; }
+
+  void execute();
+
+private:
+  struct FloatSlot {
+    std::string name;
+    float value;
+    bool tracked;
+  };
+  struct TextureSlot {
+    std::string name;
+    GLuint texture;
+    GLenum target;
+  };
+  // 一种宏定义组合下的程序及各槽位的 uniform 位置，-1 表示着色器中不存在
+  struct Variant {
+    GLuint program = 0;
+    GLint resolutionLocation = -1;
+    GLint timeLocation = -1;
+    std::vector<GLint> floatLocations;
+    std::vector<int> textureUnits;
+  };
+
+  const Variant &resolveVariant();
+
+  RenderPassInfo info;
+  GLuint framebuffer = 0;
+  GpuTimer *timer = nullptr;
+  std::vector<FloatSlot> floats;
+  std::vector<TextureSlot> textures;
+  std::vector<std::string> defineNames;
+  std::vector<int> defineValues;
+  std::vector<bool> defineTracked;
+  std::map<std::vector<int>, Variant> variants;
+  uint64_t parameterVersion = 0;
+  const Variant *current = nullptr;
+  std::vector<int> currentKey; // current 对应的宏定义取值
+};
+
 #endif /* RENDER_H */
@@ -0,0 +1,295 @@
+#include "render_graph.h"
+
+#include <iomanip> // std::setw
+#include <iostream> // 输入输出流
+
+static size_t textureBytes(int width, int height, GLenum format) {
+    return (size_t)width * height * bytesPerPixel(format);
+}
+
+void RenderGraph::reset() {
+    resources.clear();
+    passes.clear();
+}
+
+int RenderGraph::createTexture(const std::string& name, int width, int height,
+    GLenum format) {
+    Resource resource;
+    resource.name = name;
+    resource.width = width;
+    resource.height = height;
+    resource.format = format;
+    resource.imported = false;
+    resources.push_back(resource);
+    return (int)resources.size() - 1;
+}
+
+int RenderGraph::importTexture(const std::string& name, GLuint texture, int width,
+    int height) {
+    Resource resource;
+    resource.name = name;
+    resource.width = width;
+    resource.height = height;
+    resource.imported = true;
+    resource.texture = texture;
+    resources.push_back(resource);
+    return (int)resources.size() - 1;
+}
+
+void RenderGraph::setImportedTexture(int resource, GLuint texture) {
+    resources[resource].texture = texture;
+}
+
+void RenderGraph::markOutput(int resource) {
+    resources[resource].output = true;
+}
+
+int RenderGraph::addPass(const std::string& name, RenderPass* pass,
+    const std::vector<TextureRead>& reads, int write, int secondWrite) {
+    Pass p;
+    p.name = name;
+    p.pass = pass;
+    p.reads = reads;
+    p.write = write;
+    p.secondWrite = secondWrite;
+    passes.push_back(p);
+    return (int)passes.size() - 1;
+}
+
+int RenderGraph::addCallbackPass(const std::string& name, std::function<void()> callback,
+    const std::vector<int>& reads, int write) {
+    Pass p;
+    p.name = name;
+    p.pass = nullptr;
+    p.callback = std::move(callback);
+    for (int read : reads) {
+        p.reads.push_back({ -1, read });
+    }
+    p.write = write;
+    passes.push_back(p);
+    return (int)passes.size() - 1;
+}
+
+void RenderGraph::setViewport(int pass, int width, int height) {
+    passes[pass].viewportWidth = width;
+    passes[pass].viewportHeight = height;
+}
+
+void RenderGraph::compile() {
+    // 从输出反向标记需要的资源，写入结果无人读取的通道被剔除
+    std::vector<bool> needed(resources.size(), false);
+    for (size_t i = 0; i < resources.size(); i++) {
+        needed[i] = resources[i].output;
+    }
+    for (int i = (int)passes.size() - 1; i >= 0; i--) {
+        Pass& pass = passes[i];
+        pass.culled = !needed[pass.write] &&
+            (pass.secondWrite == -1 || !needed[pass.secondWrite]);
+        if (pass.culled) {
+            continue;
+        }
+        for (const TextureRead& read : pass.reads) {
+            needed[read.second] = true;
+        }
+    }
+
+    // 生存期：从写入它的通道到最后读取它的通道，输出资源保留到帧末
+    for (Resource& resource : resources) {
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+        resource.pooled = -1;
+        if (!resource.imported) {
+            resource.texture = 0;
+        }
+    }
+    for (size_t i = 0; i < passes.size(); i++) {
+        const Pass& pass = passes[i];
+        if (pass.culled) {
+            continue;
+        }
+        for (int write : { pass.write, pass.secondWrite }) {
+            if (write != -1 && resources[write].firstPass == -1) {
+                resources[write].firstPass = (int)i;
+            }
+        }
+        for (const TextureRead& read : pass.reads) {
+            Resource& source = resources[read.second];
+            if (!source.imported && source.firstPass == -1) {
+                std::cout << "WARNING: render graph pass " << pass.name
+                    << " reads " << source.name << " before it is written"
+                    << std::endl;
+            }
+            source.lastPass = (int)i;
+        }
+    }
+    for (Resource& resource : resources) {
+        if (resource.output) {
+            resource.lastPass = (int)passes.size();
+        }
+    }
+
+    // 按执行顺序贪心分配：通道写入时取一张尺寸和格式相同的空闲池纹理，
+    // 资源在最后一次读取之后归还。先分配写入再归还读取，避免同一通道读写同一纹理
+    std::vector<bool> inUse(pool.size(), false);
+    std::vector<bool> used(pool.size(), false);
+    for (size_t i = 0; i < passes.size(); i++) {
+        const Pass& pass = passes[i];
+        if (pass.culled) {
+            continue;
+        }
+
+        for (int write : { pass.write, pass.secondWrite }) {
+            if (write == -1) {
+                continue;
+            }
+            Resource& target = resources[write];
+            if (target.imported || target.pooled != -1) {
+                continue;
+            }
+            int found = -1;
+            for (size_t j = 0; j < pool.size(); j++) {
+                if (!inUse[j] && pool[j].width == target.width &&
+                    pool[j].height == target.height && pool[j].format == target.format) {
+                    found = (int)j;
+                    break;
+                }
+            }
+            if (found == -1) {
+                pool.push_back({ createColorTexture(target.width, target.height, target.format),
+                    target.width, target.height, target.format });
+                inUse.push_back(false);
+                used.push_back(false);
+                found = (int)pool.size() - 1;
+            }
+            inUse[found] = true;
+            used[found] = true;
+            target.pooled = found;
+            target.texture = pool[found].texture;
+        }
+
+        for (const TextureRead& read : pass.reads) {
+            const Resource& source = resources[read.second];
+            if (!source.imported && source.lastPass == (int)i && source.pooled != -1) {
+                inUse[source.pooled] = false;
+            }
+        }
+        // 只因另一个输出被读取而保留的通道，其无人读取的输出写完即可归还
+        for (int write : { pass.write, pass.secondWrite }) {
+            if (write != -1 && resources[write].pooled != -1 &&
+                resources[write].lastPass == -1) {
+                inUse[resources[write].pooled] = false;
+            }
+        }
+    }
+
+    // 释放本次规划用不到的池纹理并压缩下标
+    std::vector<int> remap(pool.size(), -1);
+    size_t kept = 0;
+    for (size_t j = 0; j < pool.size(); j++) {
+        if (used[j]) {
+            remap[j] = (int)kept;
+            pool[kept++] = pool[j];
+        }
+        else {
+            destroyColorTexture(pool[j].texture);
+        }
+    }
+    pool.resize(kept);
+    for (Resource& resource : resources) {
+        if (resource.pooled != -1) {
+            resource.pooled = remap[resource.pooled];
+        }
+    }
+}
+
+void RenderGraph::execute() {
+    for (Pass& pass : passes) {
+        if (pass.culled) {
+            continue;
+        }
+        if (!pass.pass) {
+            pass.callback();
+            continue;
+        }
+        for (const TextureRead& read : pass.reads) {
+            pass.pass->setTexture(read.first, resources[read.second].texture);
+        }
+        const Resource& target = resources[pass.write];
+        pass.pass->setTarget(target.texture,
+            pass.viewportWidth ? pass.viewportWidth : target.width,
+            pass.viewportHeight ? pass.viewportHeight : target.height,
+            pass.secondWrite != -1 ? resources[pass.secondWrite].texture : 0);
+        pass.pass->execute();
+    }
+}
+
+GLuint RenderGraph::texture(int resource) const {
+    return resources[resource].texture;
+}
+
+// 不做别名时每个存活的临时资源各占一张纹理
+size_t RenderGraph::transientBytes() const {
+    size_t bytes = 0;
+    for (const Resource& resource : resources) {
+        if (!resource.imported && resource.pooled != -1) {
+            bytes += textureBytes(resource.width, resource.height, resource.format);
+        }
+    }
+    return bytes;
+}
+
+size_t RenderGraph::pooledBytes() const {
+    std::vector<bool> counted(pool.size(), false);
+    size_t bytes = 0;
+    for (const Resource& resource : resources) {
+        if (resource.pooled != -1 && !counted[resource.pooled]) {
+            counted[resource.pooled] = true;
+            const PooledTexture& texture = pool[resource.pooled];
+            bytes += textureBytes(texture.width, texture.height, texture.format);
+        }
+    }
+    return bytes;
+}
+
+void RenderGraph::printMemoryPlan(std::ostream& out) const {
+    out << "render graph: " << passes.size() << " passes, ";
+    size_t culled = 0;
+    for (const Pass& pass : passes) {
+        culled += pass.culled ? 1 : 0;
+    }
+    out << culled << " culled" << std::endl;
+    for (const Pass& pass : passes) {
+        if (pass.culled) {
+            out << "  culled pass " << pass.name << std::endl;
+        }
+    }
+
+    for (const Resource& resource : resources) {
+        out << "  " << std::left << std::setw(16) << resource.name << std::right
+            << std::setw(5) << resource.width << "x" << std::left << std::setw(5)
+            << resource.height << std::right;
+        if (resource.imported) {
+            out << " imported" << std::endl;
+            continue;
+        }
+        if (resource.pooled == -1) {
+            out << " unused" << std::endl;
+            continue;
+        }
+        out << " " << std::left << std::setw(14) << internalFormatName(resource.format)
+            << std::right << " passes [" << resource.firstPass << ", ";
+        if (resource.output) {
+            out << "end";
+        }
+        else {
+            out << resource.lastPass;
+        }
+        out << "] -> pool #" << resource.pooled << std::endl;
+    }
+
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(1) << "  transient "
+        << transientBytes() / (1024.0 * 1024.0) << " MiB, aliased into "
+        << pool.size() << " textures / " << pooledBytes() / (1024.0 * 1024.0)
+        << " MiB" << std::defaultfloat << std::setprecision(precision) << std::endl;
+}
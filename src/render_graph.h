@@ -0,0 +1,100 @@
+#ifndef RENDER_GRAPH_H
+#define RENDER_GRAPH_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "render.h"
+
+// 帧图：通道声明读取和写入的纹理资源，compile() 计算每个资源的生存期，
+// 剔除结果不被使用的通道，并把生存期不重叠、尺寸和格式相同的临时资源映射到
+// 池中同一张纹理上。图结构只在需要时重建，execute() 每帧只重新绑定纹理
+class RenderGraph {
+public:
+  // (纹理槽位, 资源) 对，槽位由 RenderPass::addTexture 返回
+  typedef std::pair<int, int> TextureRead;
+
+  // 清空通道和资源声明。纹理池保留，下次编译复用尺寸和格式相同的纹理，
+  // 用不到的（例如窗口尺寸改变后）在编译结束时释放
+  void reset();
+
+  // 由图管理的临时纹理，只与尺寸和格式都相同的资源共用池纹理
+  int createTexture(const std::string &name, int width, int height,
+                    GLenum format = GL_RGB16F);
+  // 外部纹理，不参与别名分配
+  int importTexture(const std::string &name, GLuint texture, int width,
+                    int height);
+  // 更换外部资源对应的纹理（例如逐帧交替的历史纹理），不需要重新编译
+  void setImportedTexture(int resource, GLuint texture);
+  // 标记为图的输出，写入它的通道及其依赖不会被剔除
+  void markOutput(int resource);
+
+  // 按声明顺序执行，RenderPass 需在图的生存期内保持有效。
+  // secondWrite 不为-1时同时写入第二个颜色附件，尺寸须与 write 相同，
+  // 任一输出被读取时通道都不会被剔除
+  int addPass(const std::string &name, RenderPass *pass,
+              const std::vector<TextureRead> &reads, int write,
+              int secondWrite = -1);
+  // 不经过 RenderPass 的通道（例如计算着色器），由回调自行绑定纹理并执行。
+  // reads 只用于生存期和剔除，回调中用 texture() 取得资源对应的纹理
+  int addCallbackPass(const std::string &name, std::function<void()> callback,
+                      const std::vector<int> &reads, int write);
+
+  // 通道只渲染到输出资源左下角 width x height 的区域，0 表示整个资源。
+  // 只改变视口不触发重新编译，用于动态分辨率
+  void setViewport(int pass, int width, int height);
+
+  void compile();
+  void execute();
+
+  // 编译后资源对应的实际纹理
+  GLuint texture(int resource) const;
+
+  // 打印每个资源的生存期及其映射的池纹理，以及别名前后的显存占用
+  void printMemoryPlan(std::ostream &out) const;
+
+  size_t transientBytes() const;
+  size_t pooledBytes() const;
+
+private:
+  struct Resource {
+    std::string name;
+    int width;
+    int height;
+    GLenum format = GL_RGB16F;
+    bool imported;
+    bool output = false;
+    GLuint texture = 0;
+    int pooled = -1;    // 池中下标
+    int firstPass = -1; // 写入它的通道
+    int lastPass = -1;  // 最后读取它的通道
+  };
+  struct Pass {
+    std::string name;
+    RenderPass *pass;
+    std::function<void()> callback; // pass 为空时执行
+    std::vector<TextureRead> reads;
+    int write;
+    int secondWrite = -1;
+    int viewportWidth = 0;
+    int viewportHeight = 0;
+    bool culled = false;
+  };
+  struct PooledTexture {
+    GLuint texture;
+    int width;
+    int height;
+    GLenum format;
+  };
+
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+  std::vector<PooledTexture> pool;
+};
+
+#endif /* RENDER_GRAPH_H */
@@ -22,6 +22,28 @@ static std::string readFile(const std::string& file) {
     }
 }
 
+// 在#version指令之后插入宏定义，#version必须是着色器的第一条语句
+static std::string injectDefines(const std::string& source, const ShaderDefines& defines) {
+    if (defines.empty()) {
+        return source;
+    }
+
+    std::string lines;
+    for (auto const& [name, value] : defines) {
+        lines += "#define " + name + " " + value + "\n";
+    }
+
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return lines + source;
+    }
+    size_t lineEnd = source.find('\n', version);
+    if (lineEnd == std::string::npos) {
+        return source + "\n" + lines;
+    }
+    return source.substr(0, lineEnd + 1) + lines + source.substr(lineEnd + 1);
+}
+
 // 编译着色器源代码并返回着色器对象
 static GLuint compileShader(const std::string& shaderSource, GLenum shaderType) {
     // 创建着色器对象
@@ -52,14 +74,21 @@ static GLuint compileShader(const std::string& shaderSource, GLenum shaderType)
 }
 
 // 创建着色器程序，链接顶点和片段着色器
-GLuint createShaderProgram(const std::string& vertexShaderFile, const std::string& fragmentShaderFile) {
+GLuint createShaderProgram(const std::string& vertexShaderFile, const std::string& fragmentShaderFile,
+    const ShaderDefines& defines) {
     // 编译顶点着色器
     std::cout << "Compiling vertex shader: " << vertexShaderFile << std::endl;
-    GLuint vertexShader = compileShader(readFile(vertexShaderFile), GL_VERTEX_SHADER);
+    GLuint vertexShader = compileShader(injectDefines(readFile(vertexShaderFile), defines),
+        GL_VERTEX_SHADER);
 
     // 编译片段着色器
-    std::cout << "Compiling fragment shader: " << fragmentShaderFile << std::endl;
-    GLuint fragmentShader = compileShader(readFile(fragmentShaderFile), GL_FRAGMENT_SHADER);
+    std::cout << "Compiling fragment shader: " << fragmentShaderFile;
+    for (auto const& [name, value] : defines) {
+        std::cout << " " << name << "=" << value;
+    }
+    std::cout << std::endl;
+    GLuint fragmentShader = compileShader(injectDefines(readFile(fragmentShaderFile), defines),
+        GL_FRAGMENT_SHADER);
 
     // 创建着色器程序对象
     GLuint program = glCreateProgram();
@@ -91,3 +120,31 @@ GLuint createShaderProgram(const std::string& vertexShaderFile, const std::strin
 
     return program; // 返回链接成功的着色器程序对象
 }
+
+// 创建只含计算着色器的程序
+GLuint createComputeProgram(const std::string& computeShaderFile, const ShaderDefines& defines) {
+    std::cout << "Compiling compute shader: " << computeShaderFile << std::endl;
+    GLuint computeShader = compileShader(injectDefines(readFile(computeShaderFile), defines),
+        GL_COMPUTE_SHADER);
+
+    GLuint program = glCreateProgram();
+    glAttachShader(program, computeShader);
+    glLinkProgram(program);
+    GLint isLinked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &isLinked); // 检查链接状态
+    if (isLinked == GL_FALSE) {
+        int maxLength;
+        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
+        if (maxLength > 0) {
+            std::vector<GLchar> infoLog(maxLength);
+            glGetProgramInfoLog(program, maxLength, NULL, &infoLog[0]); // 获取错误日志
+            std::cout << infoLog.data() << std::endl; // 输出错误日志
+            throw std::runtime_error("Failed to link the shader."); // 抛出链接失败异常
+        }
+    }
+
+    glDetachShader(program, computeShader);
+    glDeleteShader(computeShader);
+
+    return program;
+}
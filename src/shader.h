@@ -2,9 +2,18 @@
 #define SHADER_H
 
 #include <GL/glew.h>
+#include <map>
 #include <string>
 
+// 注入到着色器 #version 之后的宏定义，名字 -> 值
+typedef std::map<std::string, std::string> ShaderDefines;
+
 GLuint createShaderProgram(const std::string &vertexShaderFile,
-                           const std::string &fragmentShaderFile);
+                           const std::string &fragmentShaderFile,
+                           const ShaderDefines &defines = {});
+
+// 计算着色器程序，需要 GL 4.3
+GLuint createComputeProgram(const std::string &computeShaderFile,
+                            const ShaderDefines &defines = {});
 
 #endif /* SHADER_H */
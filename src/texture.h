@@ -8,4 +8,8 @@ GLuint loadTexture2D(const std::string &file, bool repeat = true);
 
 GLuint loadCubemap(const std::string &cubemapDir);
 
+// 由浮点数据创建不带mipmap的二维纹理，用于查找表
+GLuint createDataTexture2D(int width, int height, GLenum internalFormat,
+                           GLenum format, const float *data);
+
 #endif /* TEXTURE_H */